@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//non-blocking DMA2D command queue, transfer complete interrupt starts the next job;
+//BSP_LCD drawing functions use DMA2D too, call dma2d_queue_flush() before them
+#define DMA2D_QUEUE_LEN                  32
+
+typedef struct{
+	uint32_t jobs;        //jobs submitted since start
+	uint32_t max_depth;   //most jobs waiting at once
+	uint32_t full_waits;  //submissions which had to wait for free slot
+	uint32_t errors;      //transfers finished with DMA2D error flag
+} dma2d_queue_stats_t;
+
+void dma2d_queue_init(void);
+
+//fills rectangle with color, addresses and offsets as for DMA2D registers (offset in pixels)
+void dma2d_queue_fill(uint32_t dst, uint32_t dst_offset, uint32_t width, uint32_t height, uint32_t color, uint32_t out_mode);
+
+//copies rectangle, converting pixel format when src_mode differs from out_mode
+void dma2d_queue_copy(uint32_t src, uint32_t src_offset, uint32_t src_mode, uint32_t dst, uint32_t dst_offset,
+	uint32_t width, uint32_t height, uint32_t out_mode);
+
+//blends foreground over destination in place, for A8/A4 foreground fg_color gives its RGB color
+void dma2d_queue_blend(uint32_t fg, uint32_t fg_offset, uint32_t fg_mode, uint32_t fg_color, uint32_t dst, uint32_t dst_offset,
+	uint32_t width, uint32_t height, uint32_t out_mode);
+
+//returns fence covering all jobs submitted so far
+uint32_t dma2d_queue_fence(void);
+
+//blocks calling task until all jobs covered by fence are done
+void dma2d_queue_wait(uint32_t fence);
+
+//waits for all submitted jobs
+void dma2d_queue_flush(void);
+
+//called from DMA2D_IRQHandler, returns false when interrupt wasn't raised by queued job
+bool dma2d_queue_irq_handler(void);
+
+const dma2d_queue_stats_t *dma2d_queue_get_stats(void);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include "stm32f7xx.h"
+
+//core cycle counter, used for time measurements finer than the 1 ms tick
+static inline void dwt_init(void){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = 0xC5ACCE55; //unlock access to DWT registers
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t dwt_cycles(void){
+	return DWT->CYCCNT;
+}
+
+static inline uint32_t dwt_cycles_to_us(uint32_t cycles){
+	return cycles / (SystemCoreClock / 1000000);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+#include "FreeRTOS.h"
+
+//key events from interrupt handlers and input drivers, render task blocks on the queue instead of polling;
+//USART1 bytes are pushed from RXNE interrupt, so bytes arriving back to back aren't lost
+#define INPUT_QUEUE_LEN                  32
+
+//held keys (key-down without key-up) repeat while the consumer asks for keys
+#define INPUT_REPEAT_DELAY_MS            300
+#define INPUT_REPEAT_PERIOD_MS           80
+
+//key posted for tap on board, argument is index of the cell
+#define INPUT_KEY_CELL                   0x80
+//key posted when the solver has a hint ready, see sokoban_hint.h
+#define INPUT_KEY_HINT                   0x81
+
+typedef enum{
+	INPUT_SOURCE_UART = 0,
+	INPUT_SOURCE_USB,
+	INPUT_SOURCE_TOUCH,
+	INPUT_SOURCE_SOLVER,
+	INPUT_SOURCE_NUM,
+} input_source_t;
+
+typedef enum{
+	INPUT_KEY_PRESS = 0, //single key stroke, e.g. terminal byte
+	INPUT_KEY_DOWN,      //key held until INPUT_KEY_UP, auto-repeated
+	INPUT_KEY_UP,
+} input_event_type_t;
+
+typedef struct{
+	uint32_t taken;        //keys taken by tasks, repeats not included
+	uint32_t min_latency;  //cycles between event and key taken by a task
+	uint32_t max_latency;
+	uint64_t sum_latency;
+} input_latency_t;
+
+typedef struct{
+	uint32_t received;     //events posted to the queue
+	uint32_t dropped;      //events lost because the queue was full
+	uint32_t overruns;     //UART overrun errors, byte lost in hardware
+	uint32_t max_depth;    //most events waiting at once
+	uint32_t repeats;      //auto-repeated keys
+	input_latency_t latency[INPUT_SOURCE_NUM];
+} input_queue_stats_t;
+
+void input_queue_init(void);
+
+//enables receive interrupt of UART, its bytes are posted as keys
+void input_queue_start_uart(UART_HandleTypeDef *huart);
+
+//posts event stamped with DWT cycle counter value when it happened, arg is passed with the key
+//to the consumer (0 for plain keys); returns false when the queue is full
+bool input_queue_post(input_source_t source, input_event_type_t type, uint8_t key, uint16_t arg, uint32_t cycles);
+
+bool input_queue_post_from_isr(input_source_t source, input_event_type_t type, uint8_t key, uint16_t arg, uint32_t cycles,
+	BaseType_t *woken);
+
+//blocks calling task until a key is pressed or repeated, or timeout (in ticks) passes
+bool input_queue_receive(uint8_t *key, uint16_t *arg, TickType_t timeout);
+
+//called from USART1_IRQHandler, returns false when no receive event was pending
+bool input_queue_uart_irq_handler(void);
+
+const input_queue_stats_t *input_queue_get_stats(void);
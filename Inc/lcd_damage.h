@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//set of damaged screen rectangles, overlapping rectangles (and neighbours whose bounding box
+//wastes no pixels) are merged, when the set is full new rectangle joins the one growing least
+#define LCD_DAMAGE_MAX_RECTS             16
+
+typedef struct{
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+} lcd_rect_t;
+
+typedef struct{
+	lcd_rect_t rects[LCD_DAMAGE_MAX_RECTS];
+	uint32_t num;
+	uint16_t screen_width;
+	uint16_t screen_height;
+	bool full;             //whole screen is damaged, rects aren't used
+} lcd_damage_t;
+
+void lcd_damage_init(lcd_damage_t *damage, uint32_t screen_width, uint32_t screen_height);
+
+void lcd_damage_clear(lcd_damage_t *damage);
+
+//marks whole screen as damaged
+void lcd_damage_all(lcd_damage_t *damage);
+
+//adds rectangle clipped to the screen
+void lcd_damage_add(lcd_damage_t *damage, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+//pixels covered by the set, merged rectangles don't overlap so there is no double counting
+uint32_t lcd_damage_pixels(const lcd_damage_t *damage);
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//double buffered LTDC layers, frames are drawn off-screen and flipped in vertical blanking
+//by the LTDC line interrupt; while a layer is double buffered its LayerCfg FBStartAdress
+//points to the back buffer, so BSP_LCD and DMA2D drawing lands off-screen
+#define LCD_FRAME_MAX_LAYERS             2
+
+#define LCD_ARGB8888_TO_RGB565(c)        ((((c) >> 8) & 0xF800) | (((c) >> 5) & 0x07E0) | (((c) >> 3) & 0x001F))
+
+typedef struct{
+	uint32_t frames;       //frames presented
+	uint32_t flips;        //frames shown on screen
+	uint32_t vblanks;      //vertical blanking periods since init
+	uint32_t missed;       //vblanks a frame was late for, counted from lcd_frame_begin()
+	uint32_t max_latency;  //most vblanks between lcd_frame_begin() and flip
+	uint32_t full_copies;  //back buffer refreshed with whole screen copy
+	uint32_t rect_copies;  //back buffer refreshed with damaged rectangles
+	uint32_t last_rects;   //merged damage rectangles of last presented frame, whole screen counts as one
+	uint32_t last_pixels;  //pixels covered by damage of last presented frame, all layers
+	uint32_t max_pixels;   //most pixels damaged in one frame
+	uint32_t total_rects;
+	uint32_t total_pixels;
+} lcd_frame_stats_t;
+
+//call once after BSP_LCD_Init(), enables the line interrupt
+void lcd_frame_init(void);
+
+//adds back buffer to layer, current layer address stays on screen;
+//called again for the same layer after the layer was reconfigured
+void lcd_frame_add_layer(uint32_t layer, uint32_t back_buffer);
+
+//waits until back buffers aren't displayed and brings them up to date with the screen,
+//with full_redraw set caller repaints every layer so the copy is skipped
+void lcd_frame_begin(bool full_redraw);
+
+//records area changed in current frame, in pixels; rectangles are merged by lcd_damage,
+//so only their union is copied back to the next back buffer
+void lcd_frame_damage(uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+//waits for queued drawing and schedules flip for next vblank, returns frame number
+uint32_t lcd_frame_present(void);
+
+//waits for pending flip and queued drawing, call before reconfiguring layers
+void lcd_frame_wait(void);
+
+//bytes per pixel of layer framebuffer
+uint32_t lcd_frame_bytes_per_pixel(uint32_t layer);
+
+//converts LCD_COLOR_* (ARGB8888) value to layer pixel format,
+//for L8 layer it's the index of the color in palette given to lcd_frame_set_palette()
+uint32_t lcd_frame_color(uint32_t layer, uint32_t argb8888);
+
+//sets palette of L8 layer and loads it to CLUT at once, colors are kept by reference
+void lcd_frame_set_palette(uint32_t layer, const uint32_t *colors, uint32_t num);
+
+//loads CLUT of L8 layer in next vblank without changing the palette used by lcd_frame_color(),
+//so colors of pixels already drawn change without redraw
+void lcd_frame_load_clut(uint32_t layer, const uint32_t *colors, uint32_t num);
+
+//queues fill of rectangle in back buffer, color as for lcd_frame_color();
+//DMA2D can't write L8, so L8 layers are filled as ARGB8888 with 4 pixels per word,
+//rectangles not aligned to 4 pixels are filled by CPU
+void lcd_frame_fill(uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t argb8888);
+
+//queues copy of rectangle in layer pixel format (source pitch equal to width) to back buffer,
+//for L8 layer x and width must be multiples of 4
+void lcd_frame_copy(uint32_t layer, uint32_t src, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+//called from LTDC_IRQHandler, returns false when line interrupt flag wasn't set
+bool lcd_frame_irq_handler(void);
+
+const lcd_frame_stats_t *lcd_frame_get_stats(void);
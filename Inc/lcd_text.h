@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "stm32746g_discovery_lcd.h"
+
+//text drawn from glyph cache in SDRAM, every glyph is one DMA2D blend job (A8 over framebuffer);
+//font bitmaps are expanded to 8-bit alpha once, only ASCII ' '..'~' is cached
+#define LCD_TEXT_FIRST_CHAR              ' '
+#define LCD_TEXT_LAST_CHAR               '~'
+#define LCD_TEXT_CACHE_SIZE              ((LCD_TEXT_LAST_CHAR - LCD_TEXT_FIRST_CHAR + 1) * 17 * 24) //fits Font24
+
+//expands font into the cache, does nothing when the font is cached already
+void lcd_text_init(sFONT *font);
+
+//queues string drawing into back buffer of direct color layer (not L8), alignment as in
+//BSP_LCD_DisplayStringAt(); only glyph pixels are blended, background is left as it is
+void lcd_text_display_at(uint32_t layer, uint32_t x, uint32_t y, const char *text, Text_AlignModeTypdef mode, uint32_t color);
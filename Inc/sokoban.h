@@ -1,33 +1,81 @@
 #pragma once
 
 #include "stm32746g_discovery_lcd.h"
+#include "sokoban_board.h"
 
 #define CELL_SIZE                        16
 #define HALF_CELL_SIZE                   (CELL_SIZE / 2)
-#define BOARD_WIDTH                      30
-#define BOARD_HEIGHT                     17
-
-#define SOKOBAN_MAP_WALL                 '*'
-#define SOKOBAN_MAP_PLAYER_ON_TARGET     '+'
-#define SOKOBAN_MAP_PLAYER               'p'
-#define SOKOBAN_MAP_TARGET               'x'
-#define SOKOBAN_MAP_STONE                'o'
-#define SOKOBAN_MAP_STONE_ON_TARGET      'd'
-#define SOKOBAN_MAP_EMPTY                ' '
-
+#define SOKOBAN_ANIM_FRAMES              4 //frames a step is tweened over, the last one shows final cells
 
 #define SOKOBAN_BACKGROUND_COLOR         LCD_COLOR_BROWN
 #define SOKOBAN_WALL_COLOR               LCD_COLOR_DARKGRAY
 #define SOKOBAN_PLAYER_COLOR             LCD_COLOR_RED
+#define SOKOBAN_DEADLOCK_COLOR           LCD_COLOR_ORANGE //player color once a stone can't reach any target
 #define SOKOBAN_STONE_COLOR              LCD_COLOR_BLUE
 #define SOKOBAN_DONE_COLOR               LCD_COLOR_DARKGREEN
 #define SOKOBAN_TARGET_COLOR             LCD_COLOR_DARKMAGENTA
+#define SOKOBAN_TRANSPARENT_COLOR        LCD_COLOR_WHITE //color key of foreground layer, see lcd_setup_layers()
+//colors are given as ARGB8888, converted to layer pixel format with lcd_frame_color()
+
+//CLUT of background layer in L8 mode, white is used by splash screens
+#define SOKOBAN_BOARD_PALETTE            {SOKOBAN_BACKGROUND_COLOR, SOKOBAN_WALL_COLOR, SOKOBAN_TARGET_COLOR, LCD_COLOR_WHITE}
 
 
+//looks for level pack on SD card, must be called after FatFs is mounted
+void sokoban_open_level_pack(void);
+
 void sokoban_init_board(void);
 
+//board state changes at once, the step is animated by sokoban_render_frame()
 void sokoban_move_player(uint32_t delta_x, uint32_t delta_y);
 
 void sokoban_spacebar_handler(void);
 
+//true while a step is being animated, new moves must wait until it ends
+bool sokoban_animating(void);
+
+//draws next frame of running animation, waits for the flip of the previous frame first,
+//so it's paced by vertical blanking; checks for level end after the last frame
+void sokoban_render_frame(void);
+
+//walks player to tapped cell along shortest path around walls and stones, tap on a stone
+//next to the player pushes it; steps are started one by one by sokoban_walk_step()
+void sokoban_walk_to(uint32_t cell_index);
+
+//true while steps of a walk are left
+bool sokoban_walking(void);
+
+//starts next step of the walk, call only when no animation is running
+void sokoban_walk_step(void);
+
+void sokoban_walk_cancel(void);
+
+//asks the solver task for a solution of current board
+void sokoban_request_hint(void);
+
+//called when the solver has finished, walks the player to the first push of the solution
+//and makes it; hints for a board which has changed meanwhile are dropped
+void sokoban_show_hint(void);
+
+//reverts or repeats last step, repainting only affected cells
+void sokoban_undo(void);
+
+void sokoban_redo(void);
+
+void sokoban_print_stats(void);
+
+void sokoban_benchmark_cell_draw(void);
+
+//repaints whole board, e.g. after layer pixel format was changed
+void sokoban_redraw_board(void);
+
+//measures full-screen clear and board redraw in current pixel format
+void sokoban_benchmark_redraw(void);
+
+//compares BSP text drawing with glyph cache
+void sokoban_benchmark_text(void);
+
+//switches board colors by loading another CLUT, works only with L8 background layer
+void sokoban_toggle_theme(void);
+
 
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+//pre-rendered cell tiles in SDRAM, every cell is drawn with single DMA2D copy
+typedef enum{
+	SOKOBAN_TILE_WALL = 0,         //background layer tiles
+	SOKOBAN_TILE_TARGET,
+	SOKOBAN_TILE_NONE,             //foreground layer tiles, drawn over color key,
+	SOKOBAN_TILE_PLAYER,           //player on target uses player tile over target on background layer
+	SOKOBAN_TILE_PLAYER_DEADLOCKED,
+	SOKOBAN_TILE_STONE,
+	SOKOBAN_TILE_STONE_ON_TARGET,
+	SOKOBAN_TILE_NUM,
+} sokoban_tile_t;
+
+//renders background tiles in pixel format of bg_layer and sprite tiles in format of fg_layer,
+//does nothing when the atlas is ready in these formats
+void sokoban_atlas_init(uint32_t bg_layer, uint32_t fg_layer);
+
+//queues copy of tile into back buffer of given layer, x and y are pixel coordinates
+void sokoban_atlas_draw(sokoban_tile_t tile, uint32_t layer, uint32_t x, uint32_t y);
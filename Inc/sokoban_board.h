@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BOARD_WIDTH                      30
+#define BOARD_HEIGHT                     17
+#define BOARD_CELLS                      (BOARD_WIDTH * BOARD_HEIGHT)
+
+#define SOKOBAN_MAP_WALL                 '*'
+#define SOKOBAN_MAP_PLAYER_ON_TARGET     '+'
+#define SOKOBAN_MAP_PLAYER               'p'
+#define SOKOBAN_MAP_TARGET               'x'
+#define SOKOBAN_MAP_STONE                'o'
+#define SOKOBAN_MAP_STONE_ON_TARGET      'd'
+#define SOKOBAN_MAP_EMPTY                ' '
+
+//x is board row, y is board column
+typedef struct{
+	uint32_t x;
+	uint32_t y;
+} sokoban_point_t;
+
+//one word per board row, bit y set when column y is occupied
+typedef uint32_t sokoban_bitset_t[BOARD_HEIGHT];
+
+typedef struct{
+	sokoban_bitset_t wall;
+	sokoban_bitset_t target;
+	sokoban_bitset_t stone;
+	sokoban_bitset_t player;
+	sokoban_bitset_t dead;     //cells from which a stone can't be pushed to any target, computed at load
+	sokoban_point_t player_pos;
+	uint32_t target_num;
+	uint32_t stones_on_target; //maintained incrementally by moves
+	uint64_t hash;             //Zobrist hash of stones and player, maintained incrementally by moves
+	bool deadlocked;           //a stone can't reach any target anymore, checked on every push
+} sokoban_board_t;
+
+typedef enum{
+	SOKOBAN_DIR_UP = 0,
+	SOKOBAN_DIR_DOWN,
+	SOKOBAN_DIR_LEFT,
+	SOKOBAN_DIR_RIGHT,
+} sokoban_dir_t;
+
+//x, y delta for every sokoban_dir_t
+extern const int32_t sokoban_dir_delta[4][2];
+
+//Zobrist keys, hash of a board is XOR of keys of its stone cells and player cell
+extern uint64_t sokoban_zobrist_stone[BOARD_CELLS];
+extern uint64_t sokoban_zobrist_player[BOARD_CELLS];
+
+typedef enum{
+	SOKOBAN_MOVE_BLOCKED = 0,
+	SOKOBAN_MOVE_WALK,
+	SOKOBAN_MOVE_PUSH,
+} sokoban_move_result_t;
+
+static inline bool sokoban_bitset_test(const uint32_t *set, sokoban_point_t pt){
+	return (set[pt.x] >> pt.y) & 1;
+}
+
+static inline void sokoban_bitset_set(uint32_t *set, sokoban_point_t pt){
+	set[pt.x] |= 1u << pt.y;
+}
+
+static inline void sokoban_bitset_clear(uint32_t *set, sokoban_point_t pt){
+	set[pt.x] &= ~(1u << pt.y);
+}
+
+//fills Zobrist keys from given seed, must be called before any board is loaded
+void sokoban_board_init_zobrist(uint64_t seed);
+
+//parses level stored as string of BOARD_WIDTH * BOARD_HEIGHT characters
+void sokoban_board_load(sokoban_board_t *board, const char *data_level);
+
+//moves player by given delta, pushing a stone when possible
+sokoban_move_result_t sokoban_board_move(sokoban_board_t *board, int32_t delta_x, int32_t delta_y);
+
+//reverts move made in given direction, pulling back the stone when it was pushed
+void sokoban_board_undo_move(sokoban_board_t *board, sokoban_dir_t dir, bool push);
+
+sokoban_dir_t sokoban_delta_to_dir(int32_t delta_x, int32_t delta_y);
+
+static inline bool sokoban_board_solved(const sokoban_board_t *board){
+	return board->stones_on_target == board->target_num;
+}
+
+//counts stones on targets by scanning whole board, reference for stones_on_target
+uint32_t sokoban_board_scan_on_target(const sokoban_board_t *board);
+
+//true when stone at given cell is on a dead cell or frozen (can't move on either axis)
+//together with a stone off target; looks only at walls, dead cells, targets and stones
+bool sokoban_board_stone_deadlocked(const sokoban_board_t *board, sokoban_point_t stone);
+
+//checks every stone, reference for deadlocked
+bool sokoban_board_scan_deadlock(const sokoban_board_t *board);
+
+//hashes whole board, reference for hash
+uint64_t sokoban_board_scan_hash(const sokoban_board_t *board);
+
+//returns SOKOBAN_MAP_* character describing given cell
+char sokoban_board_cell(const sokoban_board_t *board, sokoban_point_t pt);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sokoban_board.h"
+#include "sokoban_solver.h"
+
+//solver running in a low priority task on a copy of the board, results come back through
+//a queue and the render task is woken by INPUT_KEY_HINT in the input queue
+#define SOKOBAN_HINT_MAX_PUSHES          64 //pushes of the solution passed back, the rest is only counted
+#define SOKOBAN_HINT_SLICE_MS            20 //solver work between sleeps which let the idle task run
+
+typedef struct{
+	sokoban_solver_result_t result;
+	sokoban_bitset_t stone;    //stones of the board which was solved, to spot outdated hints
+	uint32_t push_num;         //pushes of the whole solution
+	uint16_t pushes[SOKOBAN_HINT_MAX_PUSHES];
+} sokoban_hint_t;
+
+typedef struct{
+	uint32_t requests;
+	uint32_t results[4];       //searches finished with each sokoban_solver_result_t
+	uint32_t last_expanded;
+	uint32_t last_deadlocks;   //pushes dropped by dead cells, freeze and matching checks
+	uint32_t last_repairs;     //heuristic repairs after single stone moves
+	uint32_t last_evicted;     //nodes forgotten because the table was full
+	uint32_t last_ms;
+	uint32_t last_nodes_per_sec;
+	uint32_t peak_nodes;       //most nodes stored by one search
+	uint32_t peak_open;
+	uint32_t capacity;         //nodes which fit in the table in the last search
+	uint32_t node_bytes;       //table memory per node in the last search, depends on the number of stones
+	uint32_t memory;           //SDRAM given to the solver
+} sokoban_hint_stats_t;
+
+//creates the solver task
+void sokoban_hint_start(void);
+
+//starts search for given board, search still running for older board is cancelled
+void sokoban_hint_request(const sokoban_board_t *board);
+
+//takes result of the last search, doesn't block
+bool sokoban_hint_get(sokoban_hint_t *hint);
+
+const sokoban_hint_stats_t *sokoban_hint_get_stats(void);
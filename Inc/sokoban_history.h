@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//each step takes 3 bits: 2 bit direction and push flag
+#define SOKOBAN_HISTORY_STEP_BITS        3
+#define SOKOBAN_HISTORY_STEP_PUSH        (1 << 2)
+#define SOKOBAN_HISTORY_STEPS            10240
+#define SOKOBAN_HISTORY_BYTES            (SOKOBAN_HISTORY_STEPS * SOKOBAN_HISTORY_STEP_BITS / 8)
+
+//ring buffer of steps, when full the oldest steps are forgotten
+typedef struct{
+	uint8_t data[SOKOBAN_HISTORY_BYTES];
+	uint32_t first; //ring position of oldest step
+	uint32_t count; //steps which can be undone
+	uint32_t redo;  //undone steps which can be redone
+} sokoban_history_t;
+
+void sokoban_history_clear(sokoban_history_t *history);
+
+//stores new step, drops steps available for redo
+void sokoban_history_push(sokoban_history_t *history, uint8_t step);
+
+bool sokoban_history_undo(sokoban_history_t *history, uint8_t *step);
+
+bool sokoban_history_redo(sokoban_history_t *history, uint8_t *step);
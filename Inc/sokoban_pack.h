@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ff.h"
+#include "sokoban_board.h"
+
+//level packs in standard .xsb/.sok text format, read from SD card line by line
+#define SOKOBAN_PACK_LINE_LEN            64
+
+typedef struct{
+	bool index_rebuilt;      //index was missing or outdated and the pack was scanned
+	uint32_t index_build_us;
+	uint32_t index_levels;
+	uint32_t last_load_us;   //seek and parse of the last loaded level
+	uint32_t max_load_us;
+} sokoban_pack_stats_t;
+
+//opens pack and its sidecar index (<path>.idx), the index is built when missing or
+//when pack size or modification time changed; files are kept open for level loads
+FRESULT sokoban_pack_open(const char *path);
+
+bool sokoban_pack_is_open(void);
+
+uint32_t sokoban_pack_level_num(void);
+
+//loads level as string of BOARD_CELLS characters in SOKOBAN_MAP_* format, centered on the board,
+//returns FR_INVALID_PARAMETER for levels which don't fit the board or have no single player
+FRESULT sokoban_pack_load_level(uint32_t level, char *data_level);
+
+const sokoban_pack_stats_t *sokoban_pack_get_stats(void);
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sokoban_board.h"
+
+//push found by the solver, stone cell index and sokoban_dir_t packed into 16 bits
+#define SOKOBAN_PUSH(cell, dir)          ((uint16_t)((cell) << 2 | (dir)))
+#define SOKOBAN_PUSH_CELL(push)          ((push) >> 2)
+#define SOKOBAN_PUSH_DIR(push)           ((sokoban_dir_t)((push) & 3))
+
+#define SOKOBAN_SOLVER_POLL_NODES        1024 //expansions between calls of the poll callback
+#define SOKOBAN_SOLVER_NONE              UINT32_MAX
+#define SOKOBAN_SOLVER_MAX_STONES        32   //levels with more stones or targets aren't searched
+#define SOKOBAN_SOLVER_CELL_BITS         9    //cell indices are below 512
+#define SOKOBAN_SOLVER_KEY_MAX           (((SOKOBAN_SOLVER_MAX_STONES + 1) * SOKOBAN_SOLVER_CELL_BITS + 7) / 8)
+
+typedef enum{
+	SOKOBAN_SOLVER_SOLVED = 0,
+	SOKOBAN_SOLVER_UNSOLVABLE,    //every reachable state was expanded
+	SOKOBAN_SOLVER_OUT_OF_MEMORY, //table holds only expanded nodes and the next to expand, or too many stones
+	SOKOBAN_SOLVER_CANCELLED,     //poll callback asked to stop
+} sokoban_solver_result_t;
+
+#define SOKOBAN_SOLVER_NODE_CLOSED       1
+#define SOKOBAN_SOLVER_NODE_EXPANDED     2 //has had children, so it's never forgotten
+#define SOKOBAN_SOLVER_NODE_FREE         4
+
+//search node, stored once per distinct state in the transposition table; the key is
+//the sorted stone cells followed by the player cell, SOKOBAN_SOLVER_CELL_BITS each, and
+//its size depends on the number of stones of the level; player is normalized to the
+//top-left-most cell it can reach, so states differing only by player position within
+//one area are the same
+typedef struct{
+	uint32_t parent;   //node index, SOKOBAN_SOLVER_NONE for the start, next free node when free
+	uint16_t g;        //pushes from the start
+	uint8_t h;         //lower bound of pushes left
+	uint8_t flags;
+	uint8_t key[];
+} sokoban_solver_node_t;
+
+typedef struct{
+	uint32_t expanded;
+	uint32_t generated;  //children created, including duplicates
+	uint32_t duplicates; //children already in the table
+	uint32_t deadlocks;  //pushes dropped because they make a dead or frozen stone
+	uint32_t matchings;  //heuristic computed from scratch, once per expanded node
+	uint32_t repairs;    //heuristic of a child repaired from its parent after one stone moved
+	uint32_t tables;     //push distance tables computed, 0 when the previous search was on the same level
+	uint32_t nodes;      //nodes stored in the table
+	uint32_t capacity;   //nodes which fit in the table, depends on the number of stones
+	uint32_t node_bytes; //memory taken by one node with its index slot and open list entry
+	uint32_t memory;     //bytes of the table in use
+	uint32_t evicted;    //unexpanded nodes forgotten when the table was full
+	uint32_t evictions;  //times the table was full
+	uint32_t max_open;   //largest open list
+} sokoban_solver_stats_t;
+
+//called every SOKOBAN_SOLVER_POLL_NODES expansions, lets the caller yield the CPU;
+//search is cancelled when it returns false
+typedef bool (*sokoban_solver_poll_t)(void);
+
+//min-cost assignment of targets (rows) to stones (columns) by the Hungarian algorithm;
+//potentials are kept, so after one stone moves a single augmentation repairs it
+typedef struct{
+	int32_t u[SOKOBAN_SOLVER_MAX_STONES + 1];    //row potentials, index 0 is used by the algorithm
+	int32_t v[SOKOBAN_SOLVER_MAX_STONES + 1];    //column potentials
+	uint8_t row[SOKOBAN_SOLVER_MAX_STONES + 1];  //target assigned to stone column, 0 when none
+	uint16_t cell[SOKOBAN_SOLVER_MAX_STONES];    //stone cells in column order
+} sokoban_matching_t;
+
+//A* over pushes, nodes and open list live in memory given to sokoban_solver_init(); when
+//the table fills up, open nodes with the highest g + h are forgotten and their parents
+//reopened with that bound, like in SMA*, so the search goes on in bounded memory
+typedef struct{
+	uint8_t *memory;
+	uint32_t memory_size;
+	uint8_t *nodes;      //node_size bytes each
+	uint32_t node_size;
+	uint32_t key_size;
+	uint32_t node_num;   //nodes used so far, free ones included
+	uint32_t free_node;  //list of forgotten nodes linked by parent
+	uint32_t *slots;     //open addressing index of nodes, node index + 1, 0 when empty
+	uint32_t slot_num;
+	uint32_t *open;      //binary heap of node indices ordered by g + h
+	uint32_t open_num;
+	uint32_t capacity;
+	sokoban_board_t board;         //level being solved, stones are those of the node being expanded
+	uint32_t target_num;
+	uint32_t stone_num;
+	//pushes needed to bring a stone from cell to target when no other stone is in the way, 255 when
+	//impossible; computed when a level is solved first, kept for following searches of the same level
+	uint8_t push_distance[SOKOBAN_SOLVER_MAX_STONES][BOARD_CELLS];
+	sokoban_bitset_t table_wall;
+	sokoban_bitset_t table_target;
+	bool tables_ready;
+	sokoban_matching_t matching;   //of node being expanded
+	sokoban_matching_t child;
+	uint8_t key[SOKOBAN_SOLVER_KEY_MAX + 1];  //key being looked up, one spare byte for packing
+	sokoban_solver_stats_t stats;
+} sokoban_solver_t;
+
+//memory is split into node storage, hash index and open list by every search,
+//node size depends on the number of stones
+void sokoban_solver_init(sokoban_solver_t *solver, void *memory, uint32_t size);
+
+//searches for a solution with fewest pushes, the first max_pushes of them are stored
+//in pushes and their total count in push_num
+sokoban_solver_result_t sokoban_solver_solve(sokoban_solver_t *solver, const sokoban_board_t *board,
+	uint16_t *pushes, uint32_t max_pushes, uint32_t *push_num, sokoban_solver_poll_t poll);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//FT5336 touch panel read only after its interrupt line signals new data, no I2C polling;
+//swipes are posted to the input queue as direction keys, taps on the board as INPUT_KEY_CELL
+#define TOUCH_SWIPE_MIN_PX               40  //shorter moves count as taps
+#define TOUCH_RELEASE_MS                 60  //touch ends when the panel stays silent this long
+#define TOUCH_TAP_MAX_MS                 500 //longer presses without movement are ignored
+
+typedef struct{
+	uint32_t interrupts;   //EXTI events of the panel
+	uint32_t reads;        //I2C state reads
+	uint32_t touches;
+	uint32_t swipes;
+	uint32_t taps;
+	uint32_t ignored;      //touches too long for a tap, off the board or with failed read
+} touch_stats_t;
+
+//creates the touch task, it initializes the panel and enables its interrupt
+void touch_start(void);
+
+//called from EXTI15_10_IRQHandler before other lines of the vector are handled,
+//returns false when the panel line didn't trigger
+bool touch_irq_handler(void);
+
+const touch_stats_t *touch_get_stats(void);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+//binary trace: records keep DWT cycle counter, HAL millisecond tick, address of format string and raw arguments,
+//nothing is formatted on the target; format strings live in .trace_fmt section of the ELF,
+//tools/trace_decode.c prints the records using it (see the file for dumping the buffer)
+#define TRACE_BUFFER_LEN                 512 //records, oldest are overwritten
+#define TRACE_MAX_ARGS                   3
+#define TRACE_MAGIC                      0x32435254 //"TRC2"
+
+typedef struct{
+	uint32_t cycles;
+	uint32_t tick;         //ms, lets the decoder count cycle counter wraps between distant records
+	const char *fmt;
+	uint32_t args[TRACE_MAX_ARGS];
+} trace_record_t;
+
+//layout read by the host decoder, don't reorder
+typedef struct{
+	uint32_t magic;
+	uint32_t record_num;   //TRACE_BUFFER_LEN
+	uint32_t head;         //records written since start, record n lives in records[n % TRACE_BUFFER_LEN]
+	uint32_t core_clock;   //Hz, for timestamps
+	trace_record_t records[TRACE_BUFFER_LEN];
+} trace_buffer_t;
+
+extern trace_buffer_t trace_buffer;
+
+//format string placed in .trace_fmt section, format is printf-like with 32-bit arguments
+#define TRACE_FMT(fmt) ({ static const char trace_fmt[] __attribute__((section(".trace_fmt"), used)) = fmt; trace_fmt; })
+
+#ifdef TRACE_ENABLED
+#define TRACE0(fmt)                      trace_record(TRACE_FMT(fmt), 0, 0, 0)
+#define TRACE1(fmt, a)                   trace_record(TRACE_FMT(fmt), (uint32_t)(a), 0, 0)
+#define TRACE2(fmt, a, b)                trace_record(TRACE_FMT(fmt), (uint32_t)(a), (uint32_t)(b), 0)
+#define TRACE3(fmt, a, b, c)             trace_record(TRACE_FMT(fmt), (uint32_t)(a), (uint32_t)(b), (uint32_t)(c))
+#else
+#define TRACE0(fmt)                      ((void)0)
+#define TRACE1(fmt, a)                   ((void)0)
+#define TRACE2(fmt, a, b)                ((void)0)
+#define TRACE3(fmt, a, b, c)             ((void)0)
+#endif
+
+//safe in tasks and interrupt handlers, slot is claimed with interrupts disabled for a few stores
+static inline void trace_record(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	trace_record_t *record = &trace_buffer.records[trace_buffer.head++ % TRACE_BUFFER_LEN];
+	record->cycles = DWT->CYCCNT;
+	record->tick = HAL_GetTick();
+	record->fmt = fmt;
+	record->args[0] = a0;
+	record->args[1] = a1;
+	record->args[2] = a2;
+
+	__set_PRIMASK(primask);
+}
+
+void trace_init(void);
+
+//prints buffer as hex lines for the host decoder, output waits for free log buffer space
+void trace_dump(void);
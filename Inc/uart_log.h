@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stm32f7xx_hal.h"
+
+//terminal output through RAM ring buffer drained by DMA (USART1 TX is DMA2 stream 7, channel 4),
+//xputc() only copies the character; when the buffer is full, characters are dropped
+//or the writer waits for DMA, UART_LOG_BLOCK selects the latter at start
+#define UART_LOG_BUFFER_SIZE             4096 //power of 2
+
+typedef enum{
+	UART_LOG_DROP = 0,
+	UART_LOG_BLOCK,
+} uart_log_policy_t;
+
+typedef struct{
+	uint32_t written;      //characters put into the buffer
+	uint32_t dropped;      //characters lost because the buffer was full
+	uint32_t waits;        //writers which waited for free space
+	uint32_t transfers;    //DMA transfers started
+	uint32_t max_used;     //most characters waiting at once
+} uart_log_stats_t;
+
+//output goes directly to UART with busy wait until this is called, call from a task:
+//before the scheduler starts, critical sections keep the DMA interrupt masked
+void uart_log_init(UART_HandleTypeDef *huart);
+
+//overflow policy, interrupt handlers always drop
+void uart_log_set_policy(uart_log_policy_t policy);
+
+uart_log_policy_t uart_log_get_policy(void);
+
+void uart_log_putc(char c);
+
+//waits until everything written so far is sent, call from a task
+void uart_log_flush(void);
+
+//called from DMA2_Stream7_IRQHandler, returns false when the interrupt isn't for the logger
+bool uart_log_dma_irq_handler(void);
+
+const uart_log_stats_t *uart_log_get_stats(void);
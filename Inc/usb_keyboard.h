@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "usbh_core.h"
+
+//boot protocol reports of USB HID keyboard turned into key-down/key-up events of the input queue;
+//arrows move the player that way on the LCD, like touch swipes (up/down/left/right are s/w/d/a
+//because of the board rotation in moveCursor()), letters and space to their ASCII codes, other keys are ignored
+typedef struct{
+	uint32_t reports;      //keyboard reports decoded
+	uint32_t rollovers;    //reports with too many keys pressed, ignored
+	uint32_t downs;
+	uint32_t ups;
+} usb_keyboard_stats_t;
+
+//called from USBH_HID_EventCallback() in USB host task for every report
+void usb_keyboard_report(USBH_HandleTypeDef *phost);
+
+//releases keys still held, called when the device is disconnected
+void usb_keyboard_disconnected(void);
+
+const usb_keyboard_stats_t *usb_keyboard_get_stats(void);
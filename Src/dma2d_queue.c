@@ -0,0 +1,179 @@
+#include <dma2d_queue.h>
+
+#include "stm32f7xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#define DMA2D_IFCR_ALL                   (DMA2D_IFCR_CTEIF | DMA2D_IFCR_CTCIF | DMA2D_IFCR_CTWIF | \
+                                          DMA2D_IFCR_CAECIF | DMA2D_IFCR_CCTCIF | DMA2D_IFCR_CCEIF)
+
+//register values of single transfer
+typedef struct{
+	uint32_t mode;
+	uint32_t fgmar;
+	uint32_t fgor;
+	uint32_t fgpfccr;
+	uint32_t fgcolr;
+	uint32_t bgmar;
+	uint32_t bgor;
+	uint32_t bgpfccr;
+	uint32_t ocolr;
+	uint32_t omar;
+	uint32_t oor;
+	uint32_t opfccr;
+	uint32_t nlr;
+} dma2d_job_t;
+
+static dma2d_job_t queue[DMA2D_QUEUE_LEN];
+static volatile uint32_t submitted = 0; //counters only grow, job n lives in queue[n % DMA2D_QUEUE_LEN]
+static volatile uint32_t completed = 0;
+static volatile bool running = false;
+
+static SemaphoreHandle_t done_sem;
+static dma2d_queue_stats_t stats;
+
+void dma2d_queue_init(void){
+	done_sem = xSemaphoreCreateBinary();
+
+	HAL_NVIC_SetPriority(DMA2D_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2D_IRQn);
+}
+
+static void dma2d_start(const dma2d_job_t *job){
+	DMA2D->FGMAR = job->fgmar;
+	DMA2D->FGOR = job->fgor;
+	DMA2D->FGPFCCR = job->fgpfccr;
+	DMA2D->FGCOLR = job->fgcolr;
+	DMA2D->BGMAR = job->bgmar;
+	DMA2D->BGOR = job->bgor;
+	DMA2D->BGPFCCR = job->bgpfccr;
+	DMA2D->OCOLR = job->ocolr;
+	DMA2D->OMAR = job->omar;
+	DMA2D->OOR = job->oor;
+	DMA2D->OPFCCR = job->opfccr;
+	DMA2D->NLR = job->nlr;
+	DMA2D->IFCR = DMA2D_IFCR_ALL;
+
+	DMA2D->CR = job->mode | DMA2D_CR_TCIE | DMA2D_CR_TEIE | DMA2D_CR_CEIE | DMA2D_CR_START;
+}
+
+static void dma2d_submit(const dma2d_job_t *job){
+	if(submitted - completed >= DMA2D_QUEUE_LEN){
+		stats.full_waits++;
+		while(submitted - completed >= DMA2D_QUEUE_LEN){
+			xSemaphoreTake(done_sem, portMAX_DELAY);
+		}
+	}
+
+	//slot is free, interrupt only reads slots of already submitted jobs
+	queue[submitted % DMA2D_QUEUE_LEN] = *job;
+
+	taskENTER_CRITICAL();
+	submitted++;
+	stats.jobs++;
+	if(submitted - completed > stats.max_depth){
+		stats.max_depth = submitted - completed;
+	}
+	if(!running){
+		running = true;
+		dma2d_start(&queue[completed % DMA2D_QUEUE_LEN]);
+	}
+	taskEXIT_CRITICAL();
+}
+
+bool dma2d_queue_irq_handler(void){
+	BaseType_t woken = pdFALSE;
+
+	if(!running){
+		return false;
+	}
+
+	if(DMA2D->ISR & (DMA2D_ISR_TEIF | DMA2D_ISR_CEIF)){
+		stats.errors++;
+	}else if(!(DMA2D->ISR & DMA2D_ISR_TCIF)){
+		return true;
+	}
+
+	DMA2D->IFCR = DMA2D_IFCR_ALL;
+	completed++;
+
+	if(submitted != completed){
+		dma2d_start(&queue[completed % DMA2D_QUEUE_LEN]);
+	}else{
+		running = false;
+		DMA2D->CR &= ~(DMA2D_CR_TCIE | DMA2D_CR_TEIE | DMA2D_CR_CEIE); //BSP uses polling
+	}
+
+	xSemaphoreGiveFromISR(done_sem, &woken);
+	portYIELD_FROM_ISR(woken);
+
+	return true;
+}
+
+void dma2d_queue_fill(uint32_t dst, uint32_t dst_offset, uint32_t width, uint32_t height, uint32_t color, uint32_t out_mode){
+	dma2d_job_t job = {
+		.mode = DMA2D_R2M,
+		.ocolr = color,
+		.omar = dst,
+		.oor = dst_offset,
+		.opfccr = out_mode,
+		.nlr = (width << DMA2D_NLR_PL_Pos) | height,
+	};
+
+	dma2d_submit(&job);
+}
+
+void dma2d_queue_copy(uint32_t src, uint32_t src_offset, uint32_t src_mode, uint32_t dst, uint32_t dst_offset,
+	uint32_t width, uint32_t height, uint32_t out_mode){
+	dma2d_job_t job = {
+		.mode = (src_mode == out_mode) ? DMA2D_M2M : DMA2D_M2M_PFC,
+		.fgmar = src,
+		.fgor = src_offset,
+		.fgpfccr = src_mode,
+		.omar = dst,
+		.oor = dst_offset,
+		.opfccr = out_mode,
+		.nlr = (width << DMA2D_NLR_PL_Pos) | height,
+	};
+
+	dma2d_submit(&job);
+}
+
+void dma2d_queue_blend(uint32_t fg, uint32_t fg_offset, uint32_t fg_mode, uint32_t fg_color, uint32_t dst, uint32_t dst_offset,
+	uint32_t width, uint32_t height, uint32_t out_mode){
+	dma2d_job_t job = {
+		.mode = DMA2D_M2M_BLEND,
+		.fgmar = fg,
+		.fgor = fg_offset,
+		.fgpfccr = fg_mode,
+		.fgcolr = fg_color & 0x00FFFFFF,
+		.bgmar = dst,
+		.bgor = dst_offset,
+		.bgpfccr = out_mode, //output modes share values with matching input modes
+		.omar = dst,
+		.oor = dst_offset,
+		.opfccr = out_mode,
+		.nlr = (width << DMA2D_NLR_PL_Pos) | height,
+	};
+
+	dma2d_submit(&job);
+}
+
+uint32_t dma2d_queue_fence(void){
+	return submitted;
+}
+
+void dma2d_queue_wait(uint32_t fence){
+	while((int32_t)(completed - fence) < 0){
+		xSemaphoreTake(done_sem, portMAX_DELAY);
+	}
+}
+
+void dma2d_queue_flush(void){
+	dma2d_queue_wait(dma2d_queue_fence());
+}
+
+const dma2d_queue_stats_t *dma2d_queue_get_stats(void){
+	return &stats;
+}
@@ -0,0 +1,170 @@
+#include <input_queue.h>
+
+#include "task.h"
+#include "queue.h"
+#include "dwt.h"
+
+typedef struct{
+	uint8_t source;
+	uint8_t type;
+	uint8_t key;
+	uint16_t arg;
+	uint32_t cycles;
+} input_event_t;
+
+static QueueHandle_t queue;
+static UART_HandleTypeDef *uart = NULL;
+static volatile input_queue_stats_t stats;
+
+//key held down, repeated by input_queue_receive()
+static uint8_t held_key = 0;
+static TickType_t repeat_at;
+
+void input_queue_init(void){
+	queue = xQueueCreate(INPUT_QUEUE_LEN, sizeof(input_event_t));
+	for(uint32_t i = 0; i < INPUT_SOURCE_NUM; i++){
+		stats.latency[i].min_latency = UINT32_MAX;
+	}
+}
+
+void input_queue_start_uart(UART_HandleTypeDef *huart){
+	uart = huart;
+
+	__HAL_UART_CLEAR_OREFLAG(uart);
+	__HAL_UART_ENABLE_IT(uart, UART_IT_RXNE);
+	HAL_NVIC_SetPriority(USART1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(USART1_IRQn);
+}
+
+static void input_queue_posted(bool ok, uint32_t depth){
+	if(!ok){
+		stats.dropped++;
+		return;
+	}
+
+	stats.received++;
+	if(depth > stats.max_depth){
+		stats.max_depth = depth;
+	}
+}
+
+bool input_queue_post(input_source_t source, input_event_type_t type, uint8_t key, uint16_t arg, uint32_t cycles){
+	input_event_t event = {source, type, key, arg, cycles};
+
+	bool ok = xQueueSend(queue, &event, 0) == pdTRUE;
+	taskENTER_CRITICAL();
+	input_queue_posted(ok, uxQueueMessagesWaiting(queue));
+	taskEXIT_CRITICAL();
+
+	return ok;
+}
+
+bool input_queue_post_from_isr(input_source_t source, input_event_type_t type, uint8_t key, uint16_t arg, uint32_t cycles,
+	BaseType_t *woken){
+	input_event_t event = {source, type, key, arg, cycles};
+
+	bool ok = xQueueSendFromISR(queue, &event, woken) == pdTRUE;
+	UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+	input_queue_posted(ok, uxQueueMessagesWaitingFromISR(queue));
+	taskEXIT_CRITICAL_FROM_ISR(saved);
+
+	return ok;
+}
+
+static void input_queue_latency(const input_event_t *event){
+	volatile input_latency_t *l = &stats.latency[event->source];
+	uint32_t latency = dwt_cycles() - event->cycles;
+
+	if(latency < l->min_latency){
+		l->min_latency = latency;
+	}
+	if(latency > l->max_latency){
+		l->max_latency = latency;
+	}
+	l->sum_latency += latency;
+	l->taken++;
+}
+
+bool input_queue_receive(uint8_t *key, uint16_t *arg, TickType_t timeout){
+	TickType_t start = xTaskGetTickCount();
+	bool tried = false;
+
+	for(;;){
+		TickType_t now = xTaskGetTickCount();
+		TickType_t wait = portMAX_DELAY;
+
+		if(timeout != portMAX_DELAY){
+			TickType_t elapsed = now - start;
+			if(tried && elapsed >= timeout){
+				return false;
+			}
+			wait = elapsed >= timeout ? 0 : timeout - elapsed;
+		}
+		if(held_key){ //queued key-up must be seen before repeating
+			wait = (int32_t)(repeat_at - now) <= 0 ? 0 : (wait < repeat_at - now ? wait : repeat_at - now);
+		}
+
+		input_event_t event;
+		tried = true;
+		if(xQueueReceive(queue, &event, wait) != pdTRUE){
+			now = xTaskGetTickCount();
+			if(held_key && (int32_t)(repeat_at - now) <= 0){
+				repeat_at = now + pdMS_TO_TICKS(INPUT_REPEAT_PERIOD_MS);
+				stats.repeats++;
+				*key = held_key;
+				*arg = 0;
+				return true;
+			}
+			continue;
+		}
+
+		switch(event.type){
+		case INPUT_KEY_DOWN:
+			held_key = event.key;
+			repeat_at = xTaskGetTickCount() + pdMS_TO_TICKS(INPUT_REPEAT_DELAY_MS);
+			break;
+		case INPUT_KEY_UP:
+			if(held_key == event.key){
+				held_key = 0;
+			}
+			continue;
+		default:
+			break;
+		}
+
+		input_queue_latency(&event);
+		*key = event.key;
+		*arg = event.arg;
+		return true;
+	}
+}
+
+bool input_queue_uart_irq_handler(void){
+	BaseType_t woken = pdFALSE;
+
+	if(uart == NULL){
+		return false;
+	}
+
+	uint32_t flags = uart->Instance->ISR;
+	if(!(flags & (UART_FLAG_RXNE | UART_FLAG_ORE))){
+		return false;
+	}
+
+	if(flags & UART_FLAG_ORE){
+		__HAL_UART_CLEAR_OREFLAG(uart);
+		stats.overruns++;
+	}
+
+	if(flags & UART_FLAG_RXNE){ //reading RDR clears RXNE
+		input_queue_post_from_isr(INPUT_SOURCE_UART, INPUT_KEY_PRESS, uart->Instance->RDR, 0, dwt_cycles(), &woken);
+	}
+
+	portYIELD_FROM_ISR(woken);
+
+	return true;
+}
+
+const input_queue_stats_t *input_queue_get_stats(void){
+	return (const input_queue_stats_t *)&stats;
+}
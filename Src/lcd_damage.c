@@ -0,0 +1,109 @@
+#include <lcd_damage.h>
+
+static uint32_t rect_area(const lcd_rect_t *r){
+	return r->width * r->height;
+}
+
+static bool rect_intersect(const lcd_rect_t *a, const lcd_rect_t *b){
+	return a->x < b->x + b->width && b->x < a->x + a->width &&
+		a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+static lcd_rect_t rect_union(const lcd_rect_t *a, const lcd_rect_t *b){
+	uint32_t x0 = a->x < b->x ? a->x : b->x;
+	uint32_t y0 = a->y < b->y ? a->y : b->y;
+	uint32_t x1 = (a->x + a->width > b->x + b->width) ? a->x + a->width : b->x + b->width;
+	uint32_t y1 = (a->y + a->height > b->y + b->height) ? a->y + a->height : b->y + b->height;
+
+	return (lcd_rect_t){x0, y0, x1 - x0, y1 - y0};
+}
+
+void lcd_damage_init(lcd_damage_t *damage, uint32_t screen_width, uint32_t screen_height){
+	damage->screen_width = screen_width;
+	damage->screen_height = screen_height;
+	lcd_damage_clear(damage);
+}
+
+void lcd_damage_clear(lcd_damage_t *damage){
+	damage->num = 0;
+	damage->full = false;
+}
+
+void lcd_damage_all(lcd_damage_t *damage){
+	damage->num = 0;
+	damage->full = true;
+}
+
+static void lcd_damage_remove(lcd_damage_t *damage, uint32_t i){
+	damage->rects[i] = damage->rects[--damage->num];
+}
+
+void lcd_damage_add(lcd_damage_t *damage, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
+	if(damage->full || x >= damage->screen_width || y >= damage->screen_height || !width || !height){
+		return;
+	}
+
+	if(x + width > damage->screen_width){
+		width = damage->screen_width - x;
+	}
+	if(y + height > damage->screen_height){
+		height = damage->screen_height - y;
+	}
+
+	lcd_rect_t rect = {x, y, width, height};
+
+	//merged rectangle can overlap others, so scan again until nothing merges
+	bool merged = true;
+	while(merged){
+		merged = false;
+		for(uint32_t i = 0; i < damage->num; i++){
+			lcd_rect_t *r = &damage->rects[i];
+			lcd_rect_t u = rect_union(r, &rect);
+
+			if(rect_intersect(r, &rect) || rect_area(&u) == rect_area(r) + rect_area(&rect)){
+				rect = u;
+				lcd_damage_remove(damage, i);
+				merged = true;
+				break;
+			}
+		}
+	}
+
+	if(damage->num == LCD_DAMAGE_MAX_RECTS){
+		uint32_t best = 0;
+		uint32_t best_growth = UINT32_MAX;
+		for(uint32_t i = 0; i < damage->num; i++){
+			lcd_rect_t u = rect_union(&damage->rects[i], &rect);
+			uint32_t growth = rect_area(&u) - rect_area(&damage->rects[i]);
+			if(growth < best_growth){
+				best = i;
+				best_growth = growth;
+			}
+		}
+
+		lcd_rect_t u = rect_union(&damage->rects[best], &rect);
+		lcd_damage_remove(damage, best);
+		lcd_damage_add(damage, u.x, u.y, u.width, u.height); //may overlap others now
+		return;
+	}
+
+	if(rect.width == damage->screen_width && rect.height == damage->screen_height){
+		lcd_damage_all(damage);
+		return;
+	}
+
+	damage->rects[damage->num++] = rect;
+}
+
+uint32_t lcd_damage_pixels(const lcd_damage_t *damage){
+	if(damage->full){
+		return damage->screen_width * damage->screen_height;
+	}
+
+	uint32_t pixels = 0;
+	for(uint32_t i = 0; i < damage->num; i++){
+		pixels += rect_area(&damage->rects[i]);
+	}
+
+	return pixels;
+}
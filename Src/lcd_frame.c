@@ -0,0 +1,307 @@
+#include <lcd_frame.h>
+#include <string.h>
+
+#include "stm32746g_discovery_lcd.h"
+#include "dma2d_queue.h"
+#include "lcd_damage.h"
+#include "trace.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+extern LTDC_HandleTypeDef hLtdcHandler;
+
+typedef struct{
+	uint32_t layer;
+	uint32_t front;
+	uint32_t back;
+	lcd_damage_t damage; //changed in last presented frame, missing in back buffer
+} lcd_frame_layer_t;
+
+static lcd_frame_layer_t layers[LCD_FRAME_MAX_LAYERS];
+static uint32_t layer_num = 0;
+
+//palettes of L8 layers, indexed by LTDC layer
+static const uint32_t *palette[LCD_FRAME_MAX_LAYERS];
+static uint32_t palette_num[LCD_FRAME_MAX_LAYERS];
+static const uint32_t *volatile clut_pending[LCD_FRAME_MAX_LAYERS];
+static uint32_t clut_pending_num[LCD_FRAME_MAX_LAYERS];
+
+static volatile bool flip_pending = false;
+static volatile uint32_t begin_vblank = 0;
+static SemaphoreHandle_t flip_sem;
+static volatile lcd_frame_stats_t stats;
+
+void lcd_frame_init(void){
+	flip_sem = xSemaphoreCreateBinary();
+
+	//first line after active area, shadow registers can be reloaded without tearing
+	LTDC->LIPCR = hLtdcHandler.Init.AccumulatedActiveH + 1;
+	LTDC->ICR = LTDC_ICR_CLIF;
+	LTDC->IER |= LTDC_IER_LIE;
+}
+
+void lcd_frame_add_layer(uint32_t layer, uint32_t back_buffer){
+	uint32_t i = 0;
+	while(i < layer_num && layers[i].layer != layer){
+		i++;
+	}
+	if(i == layer_num){
+		layer_num++;
+	}
+
+	lcd_frame_layer_t *l = &layers[i];
+
+	l->layer = layer;
+	l->front = hLtdcHandler.LayerCfg[layer].FBStartAdress;
+	l->back = back_buffer;
+	lcd_damage_init(&l->damage, BSP_LCD_GetXSize(), BSP_LCD_GetYSize());
+	lcd_damage_all(&l->damage); //back buffer content is unknown
+
+	hLtdcHandler.LayerCfg[layer].FBStartAdress = back_buffer;
+}
+
+uint32_t lcd_frame_bytes_per_pixel(uint32_t layer){
+	switch(hLtdcHandler.LayerCfg[layer].PixelFormat){
+	case LTDC_PIXEL_FORMAT_ARGB8888:
+		return 4;
+	case LTDC_PIXEL_FORMAT_RGB888:
+		return 3;
+	case LTDC_PIXEL_FORMAT_RGB565:
+	case LTDC_PIXEL_FORMAT_ARGB1555:
+	case LTDC_PIXEL_FORMAT_ARGB4444:
+	case LTDC_PIXEL_FORMAT_AL88:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+uint32_t lcd_frame_color(uint32_t layer, uint32_t argb8888){
+	switch(hLtdcHandler.LayerCfg[layer].PixelFormat){
+	case LTDC_PIXEL_FORMAT_RGB565:
+		return LCD_ARGB8888_TO_RGB565(argb8888);
+
+	case LTDC_PIXEL_FORMAT_L8:
+		for(uint32_t i = 0; i < palette_num[layer]; i++){
+			if(palette[layer][i] == argb8888){
+				return i;
+			}
+		}
+		return 0;
+
+	default:
+		return argb8888;
+	}
+}
+
+static void lcd_frame_write_clut(uint32_t layer, const uint32_t *colors, uint32_t num){
+	for(uint32_t i = 0; i < num; i++){
+		LTDC_LAYER(&hLtdcHandler, layer)->CLUTWR = (i << 24) | (colors[i] & 0x00FFFFFF);
+	}
+}
+
+void lcd_frame_set_palette(uint32_t layer, const uint32_t *colors, uint32_t num){
+	palette[layer] = colors;
+	palette_num[layer] = num;
+
+	lcd_frame_write_clut(layer, colors, num);
+	HAL_LTDC_EnableCLUT(&hLtdcHandler, layer);
+}
+
+void lcd_frame_load_clut(uint32_t layer, const uint32_t *colors, uint32_t num){
+	taskENTER_CRITICAL();
+	clut_pending_num[layer] = num;
+	clut_pending[layer] = colors;
+	taskEXIT_CRITICAL();
+}
+
+//sets up DMA2D job on back buffer of layer, L8 is moved as ARGB8888 words
+static void lcd_frame_dma2d(uint32_t layer, bool fill, uint32_t src, uint32_t src_offset,
+	uint32_t dst, uint32_t dst_offset, uint32_t width, uint32_t height, uint32_t color){
+	uint32_t mode = hLtdcHandler.LayerCfg[layer].PixelFormat;
+
+	if(mode == LTDC_PIXEL_FORMAT_L8){
+		mode = LTDC_PIXEL_FORMAT_ARGB8888;
+		color *= 0x01010101;
+		src_offset /= 4;
+		dst_offset /= 4;
+		width /= 4;
+	}
+
+	if(fill){
+		dma2d_queue_fill(dst, dst_offset, width, height, color, mode);
+	}else{
+		dma2d_queue_copy(src, src_offset, mode, dst, dst_offset, width, height, mode);
+	}
+}
+
+static uint32_t lcd_frame_back_address(uint32_t layer, uint32_t x, uint32_t y){
+	return hLtdcHandler.LayerCfg[layer].FBStartAdress + (y * BSP_LCD_GetXSize() + x) * lcd_frame_bytes_per_pixel(layer);
+}
+
+void lcd_frame_fill(uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t argb8888){
+	uint32_t color = lcd_frame_color(layer, argb8888);
+
+	if(hLtdcHandler.LayerCfg[layer].PixelFormat == LTDC_PIXEL_FORMAT_L8 && ((x | width) & 3)){
+		dma2d_queue_flush(); //keeps order with queued jobs
+		for(uint32_t row = 0; row < height; row++){
+			memset((void *)lcd_frame_back_address(layer, x, y + row), color, width);
+		}
+		return;
+	}
+
+	lcd_frame_dma2d(layer, true, 0, 0, lcd_frame_back_address(layer, x, y), BSP_LCD_GetXSize() - width,
+		width, height, color);
+}
+
+void lcd_frame_copy(uint32_t layer, uint32_t src, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
+	lcd_frame_dma2d(layer, false, src, 0, lcd_frame_back_address(layer, x, y), BSP_LCD_GetXSize() - width,
+		width, height, 0);
+}
+
+//copies area shown on screen to back buffer, for L8 the area is widened to whole words
+static void lcd_frame_copy_rect(const lcd_frame_layer_t *l, const lcd_rect_t *rect){
+	uint32_t width = BSP_LCD_GetXSize();
+	uint32_t x = rect->x;
+	uint32_t w = rect->width;
+
+	if(hLtdcHandler.LayerCfg[l->layer].PixelFormat == LTDC_PIXEL_FORMAT_L8){
+		w = (x + w + 3) / 4 * 4;
+		x = x / 4 * 4;
+		w -= x;
+	}
+
+	uint32_t offset = (rect->y * width + x) * lcd_frame_bytes_per_pixel(l->layer);
+	lcd_frame_dma2d(l->layer, false, l->front + offset, width - w, l->back + offset, width - w, w, rect->height, 0);
+}
+
+static void lcd_frame_wait_flip(void){
+	while(flip_pending){
+		xSemaphoreTake(flip_sem, portMAX_DELAY);
+	}
+}
+
+void lcd_frame_wait(void){
+	lcd_frame_wait_flip();
+	dma2d_queue_flush();
+}
+
+void lcd_frame_begin(bool full_redraw){
+	lcd_frame_wait_flip();
+	TRACE2("frame begin, full redraw %lu, vblank %lu", full_redraw, stats.vblanks);
+
+	begin_vblank = stats.vblanks;
+
+	for(uint32_t i = 0; i < layer_num; i++){
+		lcd_frame_layer_t *l = &layers[i];
+
+		if(!full_redraw){
+			if(l->damage.full){
+				lcd_rect_t screen = {0, 0, BSP_LCD_GetXSize(), BSP_LCD_GetYSize()};
+				lcd_frame_copy_rect(l, &screen);
+				stats.full_copies++;
+			}else{
+				for(uint32_t j = 0; j < l->damage.num; j++){
+					lcd_frame_copy_rect(l, &l->damage.rects[j]);
+				}
+				stats.rect_copies += l->damage.num;
+			}
+		}
+
+		lcd_damage_clear(&l->damage);
+	}
+}
+
+void lcd_frame_damage(uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
+	for(uint32_t i = 0; i < layer_num; i++){
+		if(layers[i].layer == layer){
+			lcd_damage_add(&layers[i].damage, x, y, width, height);
+		}
+	}
+}
+
+uint32_t lcd_frame_present(void){
+	uint32_t rects = 0;
+	uint32_t pixels = 0;
+
+	dma2d_queue_flush();
+
+	for(uint32_t i = 0; i < layer_num; i++){
+		rects += layers[i].damage.full ? 1 : layers[i].damage.num;
+		pixels += lcd_damage_pixels(&layers[i].damage);
+	}
+
+	//line interrupt may reload shadow registers for a pending CLUT, it must not see
+	//the new address of one layer and the old one of the other
+	taskENTER_CRITICAL();
+	for(uint32_t i = 0; i < layer_num; i++){
+		lcd_frame_layer_t *l = &layers[i];
+		uint32_t shown = l->back;
+
+		BSP_LCD_SetLayerAddress_NoReload(l->layer, shown); //written to shadow registers only
+
+		l->back = l->front;
+		l->front = shown;
+		hLtdcHandler.LayerCfg[l->layer].FBStartAdress = l->back;
+	}
+	flip_pending = true;
+	uint32_t frame = ++stats.frames;
+	TRACE3("frame %lu presented, %lu rectangles, %lu pixels", frame, rects, pixels);
+	stats.last_rects = rects;
+	stats.last_pixels = pixels;
+	stats.total_rects += rects;
+	stats.total_pixels += pixels;
+	if(pixels > stats.max_pixels){
+		stats.max_pixels = pixels;
+	}
+	taskEXIT_CRITICAL();
+
+	return frame;
+}
+
+bool lcd_frame_irq_handler(void){
+	BaseType_t woken = pdFALSE;
+
+	if(!(LTDC->ISR & LTDC_ISR_LIF)){
+		return false;
+	}
+
+	LTDC->ICR = LTDC_ICR_CLIF;
+	stats.vblanks++;
+
+	bool reload = flip_pending;
+	for(uint32_t layer = 0; layer < LCD_FRAME_MAX_LAYERS; layer++){
+		if(clut_pending[layer]){
+			lcd_frame_write_clut(layer, clut_pending[layer], clut_pending_num[layer]);
+			clut_pending[layer] = NULL;
+			reload = true;
+		}
+	}
+
+	if(reload){
+		LTDC->SRCR = LTDC_SRCR_IMR; //we are in vertical blanking already
+	}
+
+	if(flip_pending){
+		uint32_t latency = stats.vblanks - begin_vblank;
+		if(latency > 1){
+			stats.missed += latency - 1;
+		}
+		if(latency > stats.max_latency){
+			stats.max_latency = latency;
+		}
+
+		stats.flips++;
+		flip_pending = false;
+		xSemaphoreGiveFromISR(flip_sem, &woken);
+	}
+
+	portYIELD_FROM_ISR(woken);
+
+	return true;
+}
+
+const lcd_frame_stats_t *lcd_frame_get_stats(void){
+	return (const lcd_frame_stats_t *)&stats;
+}
@@ -0,0 +1,85 @@
+#include <lcd_text.h>
+#include <string.h>
+
+#include "dma2d_queue.h"
+#include "lcd_frame.h"
+
+extern LTDC_HandleTypeDef hLtdcHandler;
+
+static uint8_t glyph_cache[LCD_TEXT_CACHE_SIZE] __attribute__((section(".sdram")));
+static sFONT *cached_font = NULL;
+
+//same bit order as DrawChar() in BSP, rows are padded to whole bytes
+static void lcd_text_expand_glyph(const uint8_t *bitmap, uint8_t *glyph, uint32_t width, uint32_t height){
+	uint32_t row_bytes = (width + 7) / 8;
+
+	for(uint32_t y = 0; y < height; y++){
+		const uint8_t *row = bitmap + y * row_bytes;
+		for(uint32_t x = 0; x < width; x++){
+			glyph[y * width + x] = (row[x / 8] & (0x80 >> (x % 8))) ? 0xFF : 0x00;
+		}
+	}
+}
+
+void lcd_text_init(sFONT *font){
+	uint32_t glyph_size = font->Width * font->Height;
+	uint32_t bitmap_size = font->Height * ((font->Width + 7) / 8);
+
+	if(font == cached_font || glyph_size * (LCD_TEXT_LAST_CHAR - LCD_TEXT_FIRST_CHAR + 1) > LCD_TEXT_CACHE_SIZE){
+		return;
+	}
+
+	dma2d_queue_flush(); //old glyphs may be in use
+
+	for(uint32_t c = 0; c <= LCD_TEXT_LAST_CHAR - LCD_TEXT_FIRST_CHAR; c++){
+		lcd_text_expand_glyph(font->table + c * bitmap_size, glyph_cache + c * glyph_size, font->Width, font->Height);
+	}
+
+	cached_font = font;
+}
+
+void lcd_text_display_at(uint32_t layer, uint32_t x, uint32_t y, const char *text, Text_AlignModeTypdef mode, uint32_t color){
+	uint32_t screen_width = BSP_LCD_GetXSize();
+	uint32_t format = hLtdcHandler.LayerCfg[layer].PixelFormat;
+
+	if(cached_font == NULL || format == LTDC_PIXEL_FORMAT_L8){
+		return;
+	}
+
+	uint32_t width = cached_font->Width;
+	uint32_t height = cached_font->Height;
+	uint32_t size = strlen(text);
+	uint32_t columns = screen_width / width;
+	if(size > columns){
+		size = columns;
+	}
+
+	switch(mode){
+	case CENTER_MODE:
+		x += (columns - size) * width / 2;
+		break;
+	case RIGHT_MODE:
+		x = (columns - size) * width - x;
+		break;
+	default:
+		break;
+	}
+
+	uint32_t start_x = x;
+	for(; *text && x + width <= screen_width; text++, x += width){
+		char c = *text;
+		if(c < LCD_TEXT_FIRST_CHAR || c > LCD_TEXT_LAST_CHAR){
+			c = '?';
+		}
+		if(c == ' '){ //nothing to blend
+			continue;
+		}
+
+		uint32_t glyph = (uint32_t)glyph_cache + (c - LCD_TEXT_FIRST_CHAR) * width * height;
+		uint32_t dst = hLtdcHandler.LayerCfg[layer].FBStartAdress + (y * screen_width + x) * lcd_frame_bytes_per_pixel(layer);
+
+		dma2d_queue_blend(glyph, 0, DMA2D_INPUT_A8, color, dst, screen_width - width, width, height, format);
+	}
+
+	lcd_frame_damage(layer, start_x, y, x - start_x, height);
+}
@@ -82,6 +82,16 @@
 
 #include "wm8994/wm8994.h"
 #include "sokoban.h"
+#include "dwt.h"
+#include "dma2d_queue.h"
+#include "lcd_frame.h"
+#include "lcd_text.h"
+#include "input_queue.h"
+#include "usb_keyboard.h"
+#include "touch.h"
+#include "sokoban_hint.h"
+#include "uart_log.h"
+#include "trace.h"
 /* USER CODE END Includes */
 
 /* Private variables ---------------------------------------------------------*/
@@ -135,6 +145,7 @@ osThreadId defaultTaskHandle;
 
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
+osThreadId renderTaskHandle;
 
 /* USER CODE END PV */
 
@@ -174,6 +185,7 @@ void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim);
 
 /* USER CODE BEGIN PFP */
 /* Private function prototypes -----------------------------------------------*/
+void StartRenderTask(void const *argument);
 
 /* USER CODE END PFP */
 
@@ -183,33 +195,41 @@ void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim);
 #define LCD_LAYER_FG 1
 #define LCD_LAYER_BG 0
 
+//framebuffers are sized for ARGB8888, RGB565 uses first half of each
+#ifdef LCD_RGB565
+#define LCD_PIXEL_FORMAT LTDC_PIXEL_FORMAT_RGB565
+#else
+#define LCD_PIXEL_FORMAT LTDC_PIXEL_FORMAT_ARGB8888
+#endif
+
+static uint32_t lcd_pixel_format = LCD_PIXEL_FORMAT;
+
+//background (board) layer in 8-bit indexed mode, foreground keeps lcd_pixel_format
+#ifdef LCD_L8_BOARD
+static bool lcd_l8_board = true;
+#else
+static bool lcd_l8_board = false;
+#endif
+
+static const uint32_t lcd_board_palette[] = SOKOBAN_BOARD_PALETTE;
+
 static volatile uint32_t lcd_image_fg[LCD_Y_SIZE][LCD_X_SIZE] __attribute__((section(".sdram")));
 static volatile uint32_t lcd_image_bg[LCD_Y_SIZE][LCD_X_SIZE] __attribute__((section(".sdram")));
+static volatile uint32_t lcd_image_fg_back[LCD_Y_SIZE][LCD_X_SIZE] __attribute__((section(".sdram")));
+static volatile uint32_t lcd_image_bg_back[LCD_Y_SIZE][LCD_X_SIZE] __attribute__((section(".sdram")));
 
 extern ApplicationTypeDef Appli_state;
+extern LTDC_HandleTypeDef hLtdcHandler;
 extern USBH_HandleTypeDef hUsbHostFS;
 
 void USBH_HID_EventCallback(USBH_HandleTypeDef *phost)
 {
-	xprintf("hid callback!\n");
+	usb_keyboard_report(phost);
 }
 
 /* Defined in lwip.c */
 extern struct netif gnetif;
 
-char inkey(void)
-{
-	uint32_t flags = huart1.Instance->ISR;
-
-	if ((flags & UART_FLAG_RXNE) || (flags & UART_FLAG_ORE))
-	{
-		__HAL_UART_CLEAR_OREFLAG(&huart1);
-		return (huart1.Instance->RDR);
-	}
-	else
-		return 0;
-}
-
 /* can be activated in configuration */
 void ethernetif_notify_conn_changed(struct netif *netif)
 {
@@ -280,10 +300,18 @@ int main(void)
 	/* USER CODE BEGIN 2 */
 
 	debug_init(&huart1);
+	dwt_init();
+	trace_init();
+
+	uint32_t seed[2];
+	HAL_RNG_GenerateRandomNumber(&hrng, &seed[0]);
+	HAL_RNG_GenerateRandomNumber(&hrng, &seed[1]);
+	sokoban_board_init_zobrist((uint64_t)seed[0] << 32 | seed[1]);
 
 	xprintf(ANSI_FG_GREEN "STM32F746 Discovery Project" ANSI_FG_DEFAULT "\n");
 
-	xprintf("sdram map: fg@%08X , bg@%08X\n", (unsigned int)lcd_image_fg, (unsigned int)lcd_image_bg);
+	xprintf("sdram map: fg@%08X , bg@%08X, back fg@%08X , bg@%08X\n", (unsigned int)lcd_image_fg, (unsigned int)lcd_image_bg,
+		(unsigned int)lcd_image_fg_back, (unsigned int)lcd_image_bg_back);
 
 	MX_DriverVbusFS(0);
 
@@ -312,6 +340,7 @@ int main(void)
 
 	/* USER CODE BEGIN RTOS_QUEUES */
 	/* add queues, ... */
+	input_queue_init();
 	/* USER CODE END RTOS_QUEUES */
 
 	/* Start scheduler */
@@ -1532,31 +1561,93 @@ static void MX_GPIO_Init(void)
 
 /* USER CODE BEGIN 4 */
 
-static void lcd_start(void)
+static void lcd_setup_layers(uint32_t pixel_format, bool l8_board)
 {
-	BSP_LCD_Init();
-
-	BSP_LCD_LayerDefaultInit(LCD_LAYER_FG, (uint32_t)lcd_image_fg);
-	BSP_LCD_LayerDefaultInit(LCD_LAYER_BG, (uint32_t)lcd_image_bg);
+	if (pixel_format == LTDC_PIXEL_FORMAT_RGB565)
+	{
+		BSP_LCD_LayerRgb565Init(LCD_LAYER_FG, (uint32_t)lcd_image_fg);
+		BSP_LCD_LayerRgb565Init(LCD_LAYER_BG, (uint32_t)lcd_image_bg);
+	}
+	else
+	{
+		BSP_LCD_LayerDefaultInit(LCD_LAYER_FG, (uint32_t)lcd_image_fg);
+		BSP_LCD_LayerDefaultInit(LCD_LAYER_BG, (uint32_t)lcd_image_bg);
+	}
+	lcd_pixel_format = pixel_format;
 
-	BSP_LCD_DisplayOn();
+	if (l8_board)
+	{
+		HAL_LTDC_SetPixelFormat(&hLtdcHandler, LTDC_PIXEL_FORMAT_L8, LCD_LAYER_BG);
+		lcd_frame_set_palette(LCD_LAYER_BG, lcd_board_palette, sizeof(lcd_board_palette) / sizeof(uint32_t));
+	}
+	else
+	{
+		HAL_LTDC_DisableCLUT(&hLtdcHandler, LCD_LAYER_BG);
+	}
+	lcd_l8_board = l8_board;
 
-	BSP_LCD_SelectLayer(LCD_LAYER_BG);
-	BSP_LCD_Clear(LCD_COLOR_WHITE);
-	BSP_LCD_SetBackColor(LCD_COLOR_WHITE);
+	//layers aren't double buffered yet, fills go to displayed buffers
+	lcd_frame_fill(LCD_LAYER_BG, 0, 0, LCD_X_SIZE, LCD_Y_SIZE, LCD_COLOR_WHITE);
+	lcd_frame_fill(LCD_LAYER_FG, 0, 0, LCD_X_SIZE, LCD_Y_SIZE, LCD_COLOR_WHITE);
+	dma2d_queue_flush();
 
+	//BSP takes colors in layer format, text is drawn on foreground only
 	BSP_LCD_SelectLayer(LCD_LAYER_FG);
-	BSP_LCD_Clear(LCD_COLOR_WHITE);
-	BSP_LCD_SetBackColor(LCD_COLOR_WHITE);
+	BSP_LCD_SetBackColor(lcd_frame_color(LCD_LAYER_FG, LCD_COLOR_WHITE));
 
+	//color key is compared after conversion to RGB888, RGB565 white expands to 0xFFFFFF
 	BSP_LCD_SetColorKeying(LCD_LAYER_FG, LCD_COLOR_WHITE);
 
 	BSP_LCD_SetTransparency(LCD_LAYER_BG, 255);
 	BSP_LCD_SetTransparency(LCD_LAYER_FG, 255);
+
+	//from now on drawing goes to back buffers
+	lcd_frame_add_layer(LCD_LAYER_FG, (uint32_t)lcd_image_fg_back);
+	lcd_frame_add_layer(LCD_LAYER_BG, (uint32_t)lcd_image_bg_back);
+}
+
+static void lcd_start(void)
+{
+	BSP_LCD_Init();
+	dma2d_queue_init();
+	lcd_frame_init();
+	lcd_text_init(&Font24);
+
+	lcd_setup_layers(lcd_pixel_format, lcd_l8_board);
+
+	BSP_LCD_DisplayOn();
+}
+
+static void lcd_set_pixel_format(uint32_t pixel_format, bool l8_board)
+{
+	lcd_frame_wait(); //layers can't be reconfigured with flip or DMA2D job pending
+	lcd_setup_layers(pixel_format, l8_board);
+	sokoban_redraw_board();
+
+	xprintf("pixel format: %s, board layer %s\n", pixel_format == LTDC_PIXEL_FORMAT_RGB565 ? "RGB565" : "ARGB8888",
+		l8_board ? "L8" : "same");
+}
+
+static void lcd_benchmark_pixel_formats(void)
+{
+	uint32_t current = lcd_pixel_format;
+	bool current_l8 = lcd_l8_board;
+
+	lcd_set_pixel_format(LTDC_PIXEL_FORMAT_ARGB8888, false);
+	sokoban_benchmark_redraw();
+
+	lcd_set_pixel_format(LTDC_PIXEL_FORMAT_RGB565, false);
+	sokoban_benchmark_redraw();
+
+	lcd_set_pixel_format(LTDC_PIXEL_FORMAT_RGB565, true);
+	sokoban_benchmark_redraw();
+
+	lcd_set_pixel_format(current, current_l8);
 }
 
 void draw_background(void)
 {
+	sokoban_open_level_pack();
 	sokoban_init_board();
 }
 
@@ -1570,6 +1661,132 @@ int moveCursor(int xShift, int yShift)
 	return 0;
 }
 
+static void print_input_stats(void)
+{
+	const input_queue_stats_t *input = input_queue_get_stats();
+
+	const usb_keyboard_stats_t *keyboard = usb_keyboard_get_stats();
+	static const char *sources[INPUT_SOURCE_NUM] = {"UART", "USB", "touch", "solver"};
+
+	xprintf("input: %lu events, dropped %lu, UART overruns %lu, max queue depth %lu, repeats %lu\n",
+		input->received, input->dropped, input->overruns, input->max_depth, input->repeats);
+	xprintf("USB keyboard: %lu reports, %lu rollovers, %lu key downs, %lu key ups\n",
+		keyboard->reports, keyboard->rollovers, keyboard->downs, keyboard->ups);
+	const touch_stats_t *touch = touch_get_stats();
+	xprintf("touch: %lu interrupts, %lu reads, %lu touches, %lu swipes, %lu taps, %lu ignored\n",
+		touch->interrupts, touch->reads, touch->touches, touch->swipes, touch->taps, touch->ignored);
+	for (uint32_t i = 0; i < INPUT_SOURCE_NUM; i++)
+	{
+		const input_latency_t *l = &input->latency[i];
+		if (l->taken)
+		{
+			xprintf("%s key to task latency: min %lu cycles, avg %lu cycles, max %lu cycles (%lu us)\n", sources[i],
+				l->min_latency, (uint32_t)(l->sum_latency / l->taken), l->max_latency, dwt_cycles_to_us(l->max_latency));
+		}
+	}
+
+	const uart_log_stats_t *log = uart_log_get_stats();
+	xprintf("log: %lu chars, dropped %lu, writer waits %lu, %lu DMA transfers, max buffered %lu, %s when full\n",
+		log->written, log->dropped, log->waits, log->transfers, log->max_used,
+		uart_log_get_policy() == UART_LOG_BLOCK ? "block" : "drop");
+	xprintf("trace: %lu records, %u kept\n", trace_buffer.head, TRACE_BUFFER_LEN);
+}
+
+static void handle_key(uint8_t key, uint16_t arg)
+{
+	const int CURSOR_MOVE_STEP = 1;
+
+	// xprintf("key = %c (0x%02X)\n", (char)key, (unsigned int)key);
+	switch (key)
+	{
+	case 'w':
+		moveCursor(0, -CURSOR_MOVE_STEP);
+		break;
+	case 's':
+		moveCursor(0, CURSOR_MOVE_STEP);
+		break;
+	case 'a':
+		moveCursor(-CURSOR_MOVE_STEP, 0);
+		break;
+	case 'd':
+		moveCursor(CURSOR_MOVE_STEP, 0);
+		break;
+	case ' ':
+		sokoban_spacebar_handler();
+		break;
+	case 'u':
+		sokoban_undo();
+		break;
+	case 'r':
+		sokoban_redo();
+		break;
+	case 'i':
+		sokoban_print_stats();
+		print_input_stats();
+		break;
+	case 'b':
+		sokoban_benchmark_cell_draw();
+		break;
+	case 'm':
+		lcd_set_pixel_format(lcd_pixel_format == LTDC_PIXEL_FORMAT_RGB565 ? LTDC_PIXEL_FORMAT_ARGB8888 : LTDC_PIXEL_FORMAT_RGB565, lcd_l8_board);
+		break;
+	case 'l':
+		lcd_set_pixel_format(lcd_pixel_format, !lcd_l8_board);
+		break;
+	case 't':
+		sokoban_toggle_theme();
+		break;
+	case 'f':
+		sokoban_benchmark_text();
+		break;
+	case 'p':
+		lcd_benchmark_pixel_formats();
+		break;
+	case 'x':
+		trace_dump();
+		break;
+	case 'o':
+		uart_log_set_policy(uart_log_get_policy() == UART_LOG_BLOCK ? UART_LOG_DROP : UART_LOG_BLOCK);
+		break;
+	case 'h':
+		sokoban_request_hint();
+		break;
+	case INPUT_KEY_CELL:
+		sokoban_walk_to(arg);
+		break;
+	case INPUT_KEY_HINT:
+		sokoban_show_hint();
+		break;
+	}
+}
+
+//animation frames are drawn back to back, each waits for vblank flip of the previous one;
+//keys are taken from the input queue only between animations, typed ahead keys wait there;
+//walk to a tapped cell goes on step by step until it ends or any key comes
+void StartRenderTask(void const *argument)
+{
+	for (;;)
+	{
+		if (sokoban_animating())
+		{
+			sokoban_render_frame();
+			continue;
+		}
+
+		uint8_t key;
+		uint16_t arg;
+		if (input_queue_receive(&key, &arg, sokoban_walking() ? 0 : portMAX_DELAY))
+		{
+			sokoban_walk_cancel();
+			handle_key(key, arg);
+		}
+		else
+		{
+			sokoban_walk_step();
+		}
+	}
+}
+
 /* USER CODE END 4 */
 
 /* StartDefaultTask function */
@@ -1585,41 +1802,24 @@ void StartDefaultTask(void const *argument)
 	MX_LWIP_Init();
 
 	/* USER CODE BEGIN 5 */
+	uart_log_init(&huart1);
 	lcd_start();
 	draw_background();
 
+	//render task owns LCD and game state from now on
+	osThreadDef(renderTask, StartRenderTask, osPriorityAboveNormal, 0, 2048);
+	renderTaskHandle = osThreadCreate(osThread(renderTask), NULL);
+
+	input_queue_start_uart(&huart1);
+	touch_start();
+	sokoban_hint_start();
+
 	/* Infinite loop */
 	for (;;)
 	{
 		HAL_IWDG_Refresh(&hiwdg);
-		osDelay(5);
+		osDelay(100); //keys come from USART1 interrupt, this task only feeds the watchdog
 		LD1_TOGGLE; /* Just blink to say "I'm alive" */
-
-		uint8_t key = inkey();
-		if (key)
-		{
-			const int CURSOR_MOVE_STEP = 1;
-
-			// xprintf("key = %c (0x%02X)\n", (char)key, (unsigned int)key);
-			switch (key)
-			{
-			case 'w':
-				moveCursor(0, -CURSOR_MOVE_STEP);
-				break;
-			case 's':
-				moveCursor(0, CURSOR_MOVE_STEP);
-				break;
-			case 'a':
-				moveCursor(-CURSOR_MOVE_STEP, 0);
-				break;
-			case 'd':
-				moveCursor(CURSOR_MOVE_STEP, 0);
-				break;
-			case ' ':
-				sokoban_spacebar_handler();
-				break;
-			}
-		}
 	}
 	/* USER CODE END 5 */
 }
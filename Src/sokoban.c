@@ -1,23 +1,75 @@
 #include <sokoban.h>
+#include <sokoban_atlas.h>
+#include <sokoban_history.h>
+#include <sokoban_pack.h>
+#include <sokoban_hint.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "term_io.h"
-
-typedef struct{
-	uint32_t x;
-	uint32_t y;
-} sokoban_point_t;
-
-sokoban_point_t player;
+#include "dwt.h"
+#include "dma2d_queue.h"
+#include "lcd_frame.h"
+#include "lcd_text.h"
+#include "trace.h"
 
 int sokoban_current_level = 0;
 uint32_t total_levels = 0;
 uint32_t sokoban_target_num = 0;
-char *sokoban_current_level_data;
+sokoban_board_t sokoban_board;
 bool in_game = false;
 
+static sokoban_history_t sokoban_history;
+
+//cells changed by the current move, repainted instead of the whole board
+#define SOKOBAN_MAX_DIRTY_CELLS          4
+static uint32_t sokoban_dirty_cells[SOKOBAN_MAX_DIRTY_CELLS];
+static uint32_t sokoban_dirty_num = 0;
+
+//pixels written to the framebuffers, used to measure SDRAM traffic per move
+static uint32_t sokoban_pixels_written = 0;
+static uint32_t sokoban_last_move_pixels = 0;
+static uint32_t sokoban_board_draw_pixels = 0;
+
+//number of last frame handed to lcd_frame_present()
+static uint32_t sokoban_last_frame = 0;
+
+//step being tweened, the board is already in its final state and sprites of moved
+//player and stone are drawn between their old and new cells
+typedef struct{
+	uint32_t from;
+	uint32_t to;
+} sokoban_anim_sprite_t;
+
+static sokoban_anim_sprite_t sokoban_anim_sprites[2];
+static uint32_t sokoban_anim_sprite_num = 0;
+static uint32_t sokoban_anim_frame = 0; //next frame to draw, 0 when nothing is animated
+static bool sokoban_anim_check_end = false;
+
+//animation frame times, measured between consecutive flips
+static uint32_t sokoban_anim_frames = 0;
+static uint32_t sokoban_anim_frame_min_us = UINT32_MAX;
+static uint32_t sokoban_anim_frame_max_us = 0;
+static uint32_t sokoban_anim_frame_sum_us = 0;
+static uint32_t sokoban_anim_missed = 0;    //frames shown later than one vblank after previous one
+static uint32_t sokoban_anim_last_cycles = 0;
+static uint32_t sokoban_anim_last_vblank = 0;
+
+//DWT cycles spent drawing single cells
+static uint32_t sokoban_cell_draw_cycles = 0;
+static uint32_t sokoban_cell_draw_num = 0;
+static uint32_t sokoban_cell_draw_max_cycles = 0;
+
+//path of walk to tapped cell, one step is started whenever the previous animation ends
+static uint8_t sokoban_walk_path[BOARD_CELLS];
+static uint32_t sokoban_walk_len = 0;
+static uint32_t sokoban_walk_pos = 0;
+
+//pack files looked up on SD card, built-in levels are used when none is found
+static const char *sokoban_pack_paths[] = {"levels.xsb", "levels.sok"};
+static char sokoban_pack_level[BOARD_CELLS + 1];
+
 //one level stored as string of BOARD_WIDTH * BOARD_HEIGHT characters
 char *sokoban_levels[] = {
 	"                                                                       *****                         *   *                         *   *                         *   ******                    *  xo    *                    *       p*                    *        *                    *  xo    *                    *   ******                    *   ******                    *   ******                    **********                                                                                                   ",
@@ -30,8 +82,20 @@ char *sokoban_levels[] = {
 #define LCD_LAYER_FG 1
 #define LCD_LAYER_BG 0
 
-static char sokoban_get_cell_value_by_pos(sokoban_point_t pt);
-static void sokoban_draw_board(char *data_level);
+extern LTDC_HandleTypeDef hLtdcHandler;
+
+//CLUTs loaded to L8 background layer, indices match SOKOBAN_BOARD_PALETTE
+static const uint32_t sokoban_board_clut[] = SOKOBAN_BOARD_PALETTE;
+static const uint32_t sokoban_dark_clut[] = {LCD_COLOR_BLACK, LCD_COLOR_GRAY, LCD_COLOR_DARKCYAN, LCD_COLOR_WHITE};
+static const uint32_t sokoban_flash_clut[] = {SOKOBAN_DONE_COLOR, SOKOBAN_WALL_COLOR, SOKOBAN_TARGET_COLOR, LCD_COLOR_WHITE};
+static bool sokoban_dark_theme = false;
+
+#define SOKOBAN_CLUT_SIZE                (sizeof(sokoban_board_clut) / sizeof(uint32_t))
+
+static void sokoban_draw_board(void);
+static void sokoban_draw_static_cell(uint32_t cell_index, char cell);
+static void sokoban_draw_sprite_cell(uint32_t cell_index, char cell, bool clear);
+static void sokoban_stop_animation(void);
 static void check_game_end(void);
 
 static uint32_t cell_idx_to_x(int cell_idx){
@@ -46,181 +110,515 @@ static uint32_t sokoban_x_y_to_idx(sokoban_point_t pt){
 	return pt.x * BOARD_WIDTH + pt.y;
 }
 
-static void sokoban_idx_to_x_y(uint32_t idx, sokoban_point_t *pt){
-	pt->x = cell_idx_to_x(idx);
-	pt->y = cell_idx_to_y(idx);
+void sokoban_open_level_pack(void){
+	total_levels = sizeof(sokoban_levels) / sizeof(char *);
+
+	for(uint32_t i = 0; i < sizeof(sokoban_pack_paths) / sizeof(char *); i++){
+		if(sokoban_pack_open(sokoban_pack_paths[i]) == FR_OK){
+			total_levels = sokoban_pack_level_num();
+			xprintf("Level pack %s opened, %ld levels\n", sokoban_pack_paths[i], total_levels);
+			return;
+		}
+	}
+
+	xprintf("No level pack found, using built-in levels\n");
 }
 
-static char sokoban_get_cell_value_by_pos(sokoban_point_t pt){
-	return sokoban_current_level_data[sokoban_x_y_to_idx(pt)];
+static const char *sokoban_get_level_data(void){
+	if(!sokoban_pack_is_open()){
+		return sokoban_levels[sokoban_current_level];
+	}
+
+	FRESULT res = sokoban_pack_load_level(sokoban_current_level, sokoban_pack_level);
+	if(res != FR_OK){
+		xprintf("Level %d can't be loaded from pack (error %d), using built-in level\n", sokoban_current_level, res);
+		return sokoban_levels[sokoban_current_level % (sizeof(sokoban_levels) / sizeof(char *))];
+	}
+
+	return sokoban_pack_level;
 }
 
-static char *sokoban_get_cell_by_pos(sokoban_point_t pt){
-	return &sokoban_current_level_data[sokoban_x_y_to_idx(pt)];
+void sokoban_init_board(){
+	sokoban_stop_animation();
+	sokoban_walk_cancel();
+	sokoban_board_load(&sokoban_board, sokoban_get_level_data());
+	sokoban_draw_board();
+
+	sokoban_history_clear(&sokoban_history);
+
+	sokoban_target_num = sokoban_board.target_num;
+
+	xprintf("Level %d/%ld loaded! %ld targets\n", sokoban_current_level, total_levels, sokoban_target_num);
+
+	in_game = true;
 }
 
-static uint32_t char_occurences(const char *s, char c){
-	uint32_t cnt = 0;
-	for(int i = 0; s[i]; i++){
-		cnt += (s[i] == c);
+//draws cell with single DMA2D copy from the sprite atlas
+static void sokoban_draw_tile(sokoban_tile_t tile, uint32_t layer, uint32_t cell_index){
+	uint32_t y = cell_idx_to_x(cell_index) * CELL_SIZE;
+	uint32_t x = cell_idx_to_y(cell_index) * CELL_SIZE;
+
+	uint32_t start = dwt_cycles();
+	sokoban_atlas_draw(tile, layer, x, y);
+	lcd_frame_damage(layer, x, y, CELL_SIZE, CELL_SIZE);
+	uint32_t cycles = dwt_cycles() - start;
+	TRACE3("tile %lu on layer %lu, cell %lu", tile, layer, cell_index);
+
+	sokoban_pixels_written += CELL_SIZE * CELL_SIZE;
+	sokoban_cell_draw_cycles += cycles;
+	sokoban_cell_draw_num++;
+	if(cycles > sokoban_cell_draw_max_cycles){
+		sokoban_cell_draw_max_cycles = cycles;
 	}
+}
 
-	return cnt;
+//draws sprite at any pixel position, used for cells in between while animating
+static void sokoban_draw_sprite_at(sokoban_tile_t tile, uint32_t x, uint32_t y){
+	sokoban_atlas_draw(tile, LCD_LAYER_FG, x, y);
+	lcd_frame_damage(LCD_LAYER_FG, x, y, CELL_SIZE, CELL_SIZE);
+	sokoban_pixels_written += CELL_SIZE * CELL_SIZE;
 }
 
-void sokoban_clear_level(){
-	free(sokoban_current_level_data);
-	sokoban_current_level_data = NULL;
+static void sokoban_clear_layer(uint32_t layer, uint32_t color){
+	BSP_LCD_SelectLayer(layer);
+	lcd_frame_fill(layer, 0, 0, BSP_LCD_GetXSize(), BSP_LCD_GetYSize(), color);
+	lcd_frame_damage(layer, 0, 0, BSP_LCD_GetXSize(), BSP_LCD_GetYSize());
+	sokoban_pixels_written += BSP_LCD_GetXSize() * BSP_LCD_GetYSize();
 }
 
-void sokoban_init_board(){
-	char *data_level = sokoban_levels[sokoban_current_level];
+//static elements (walls, targets) go to background layer once per level,
+//foreground layer holds only player and stones over transparent color
+static void sokoban_draw_board(void)
+{
+	sokoban_pixels_written = 0;
 
-	sokoban_draw_board(data_level);
-	sokoban_current_level_data = strdup(data_level);
+	sokoban_atlas_init(LCD_LAYER_BG, LCD_LAYER_FG);
 
-	char *pl_idx = strchr(sokoban_current_level_data, SOKOBAN_MAP_PLAYER);
-	uint32_t offset = pl_idx - sokoban_current_level_data;
+	lcd_frame_begin(true);
+	sokoban_clear_layer(LCD_LAYER_BG, SOKOBAN_BACKGROUND_COLOR);
+	sokoban_clear_layer(LCD_LAYER_FG, SOKOBAN_TRANSPARENT_COLOR);
 
-	sokoban_idx_to_x_y(offset, &player);
-	sokoban_target_num = char_occurences(sokoban_current_level_data, SOKOBAN_MAP_TARGET);
-	total_levels = sizeof(sokoban_levels) / sizeof(char *);
+	for(uint32_t cell_index = 0; cell_index < BOARD_CELLS; cell_index++){
+		sokoban_point_t pt = {cell_idx_to_x(cell_index), cell_idx_to_y(cell_index)};
+		char c = sokoban_board_cell(&sokoban_board, pt);
 
-	xprintf("Level %d/%ld loaded! %ld targets\n", sokoban_current_level, total_levels, sokoban_target_num);
+		if(c != SOKOBAN_MAP_EMPTY){ //layers are already cleared
+			sokoban_draw_static_cell(cell_index, c);
+			sokoban_draw_sprite_cell(cell_index, c, false);
+		}
+	}
 
-	in_game = true;
+	sokoban_last_frame = lcd_frame_present();
+
+	sokoban_board_draw_pixels = sokoban_pixels_written;
+	sokoban_dirty_num = 0;
+}
+
+static bool sokoban_board_indexed(void){
+	return hLtdcHandler.LayerCfg[LCD_LAYER_BG].PixelFormat == LTDC_PIXEL_FORMAT_L8;
+}
+
+static void sokoban_load_theme(void){
+	lcd_frame_load_clut(LCD_LAYER_BG, sokoban_dark_theme ? sokoban_dark_clut : sokoban_board_clut, SOKOBAN_CLUT_SIZE);
 }
 
-static void sokoban_draw_board(char *data_level)
+void sokoban_redraw_board(void){
+	if(sokoban_board_indexed()){
+		sokoban_load_theme(); //layer setup loads default palette
+	}
+	sokoban_draw_board();
+}
+
+void sokoban_toggle_theme(void){
+	if(!sokoban_board_indexed()){
+		xprintf("themes need L8 board layer\n");
+		return;
+	}
+
+	sokoban_dark_theme = !sokoban_dark_theme;
+	sokoban_load_theme();
+}
+
+static void sokoban_draw_static_cell(uint32_t cell_index, char cell)
 {
-	BSP_LCD_SelectLayer(LCD_LAYER_BG);
-	BSP_LCD_Clear(SOKOBAN_BACKGROUND_COLOR);
-	BSP_LCD_SelectLayer(LCD_LAYER_FG);
-	BSP_LCD_Clear(SOKOBAN_BACKGROUND_COLOR);
-
-	uint32_t cell_index = 0;
-	char *c = data_level;
-	while (*c){
-		uint32_t y = cell_idx_to_x(cell_index) * CELL_SIZE;
-		uint32_t x = cell_idx_to_y(cell_index) * CELL_SIZE;
-
-		switch (*c){
-		case SOKOBAN_MAP_WALL: //wall
-			BSP_LCD_SetTextColor(SOKOBAN_WALL_COLOR);
-			BSP_LCD_FillRect(x, y, CELL_SIZE, CELL_SIZE);
-			break;
-
-		case SOKOBAN_MAP_PLAYER_ON_TARGET: //player standing on target field
-			BSP_LCD_SetTextColor(SOKOBAN_TARGET_COLOR);
-			BSP_LCD_FillRect(x, y, CELL_SIZE, CELL_SIZE);
-
-			//fallthrough to draw player
-
-		case SOKOBAN_MAP_PLAYER: //player
-			BSP_LCD_SetTextColor(SOKOBAN_PLAYER_COLOR);
-			BSP_LCD_FillCircle(x + HALF_CELL_SIZE, y + HALF_CELL_SIZE, HALF_CELL_SIZE - 1);
-			break;
-
-		case SOKOBAN_MAP_TARGET: //target field
-			BSP_LCD_SetTextColor(SOKOBAN_TARGET_COLOR);
-			BSP_LCD_FillRect(x, y, CELL_SIZE, CELL_SIZE);
-			break;
-		
-		case SOKOBAN_MAP_STONE: //stone
-			BSP_LCD_SetTextColor(SOKOBAN_STONE_COLOR);
-			BSP_LCD_FillCircle(x + HALF_CELL_SIZE, y + HALF_CELL_SIZE, HALF_CELL_SIZE - 3);
-			break;
-
-		case SOKOBAN_MAP_STONE_ON_TARGET:
-			BSP_LCD_SetTextColor(SOKOBAN_TARGET_COLOR);
-			BSP_LCD_FillRect(x, y, CELL_SIZE, CELL_SIZE);
-
-			BSP_LCD_SetTextColor(SOKOBAN_DONE_COLOR);
-			BSP_LCD_FillCircle(x + HALF_CELL_SIZE, y + HALF_CELL_SIZE, HALF_CELL_SIZE - 3);
-			break;
+	switch (cell){
+	case SOKOBAN_MAP_WALL: //wall
+		sokoban_draw_tile(SOKOBAN_TILE_WALL, LCD_LAYER_BG, cell_index);
+		break;
+
+	case SOKOBAN_MAP_PLAYER_ON_TARGET: //target field, possibly covered by foreground
+	case SOKOBAN_MAP_STONE_ON_TARGET:
+	case SOKOBAN_MAP_TARGET:
+		sokoban_draw_tile(SOKOBAN_TILE_TARGET, LCD_LAYER_BG, cell_index);
+		break;
+	}
+}
+
+//foreground tile of cell, SOKOBAN_TILE_NONE for cells without player or stone
+static sokoban_tile_t sokoban_sprite_tile(char cell){
+	switch (cell){
+	case SOKOBAN_MAP_PLAYER_ON_TARGET: //player
+	case SOKOBAN_MAP_PLAYER:
+		return sokoban_board.deadlocked ? SOKOBAN_TILE_PLAYER_DEADLOCKED : SOKOBAN_TILE_PLAYER;
+
+	case SOKOBAN_MAP_STONE: //stone
+		return SOKOBAN_TILE_STONE;
+
+	case SOKOBAN_MAP_STONE_ON_TARGET:
+		return SOKOBAN_TILE_STONE_ON_TARGET;
+
+	default:
+		return SOKOBAN_TILE_NONE;
+	}
+}
+
+//draws player or stone on foreground layer, sprite tiles cover whole cell so the cell
+//is repainted in place; with clear set cells without sprite are made transparent
+static void sokoban_draw_sprite_cell(uint32_t cell_index, char cell, bool clear)
+{
+	sokoban_tile_t tile = sokoban_sprite_tile(cell);
+
+	if(tile != SOKOBAN_TILE_NONE || clear){
+		sokoban_draw_tile(tile, LCD_LAYER_FG, cell_index);
+	}
+}
+
+static void sokoban_mark_dirty(sokoban_point_t pt){
+	uint32_t idx = sokoban_x_y_to_idx(pt);
+
+	for(uint32_t i = 0; i < sokoban_dirty_num; i++){
+		if(sokoban_dirty_cells[i] == idx){
+			return;
 		}
+	}
 
-		c++;
-		cell_index++;
+	if(sokoban_dirty_num < SOKOBAN_MAX_DIRTY_CELLS){
+		sokoban_dirty_cells[sokoban_dirty_num++] = idx;
 	}
 }
 
-static void update_game_data(sokoban_point_t old, sokoban_point_t new, bool redraw){
-	char *old_data = sokoban_get_cell_by_pos(old);
-	char *new_data = sokoban_get_cell_by_pos(new);
+//repaints only cells changed since last flush, background layer never changes during a level
+static void sokoban_draw_dirty_cells(void){
+	for(uint32_t i = 0; i < sokoban_dirty_num; i++){
+		uint32_t idx = sokoban_dirty_cells[i];
+		sokoban_point_t pt = {cell_idx_to_x(idx), cell_idx_to_y(idx)};
+		sokoban_draw_sprite_cell(idx, sokoban_board_cell(&sokoban_board, pt), true);
+	}
 
-	if(*old_data == SOKOBAN_MAP_PLAYER){
-		if(*new_data == SOKOBAN_MAP_EMPTY){
-			*old_data = SOKOBAN_MAP_EMPTY;
-			*new_data = SOKOBAN_MAP_PLAYER;
-		}else if(*new_data == SOKOBAN_MAP_TARGET){
-			*old_data = SOKOBAN_MAP_EMPTY;
-			*new_data = SOKOBAN_MAP_PLAYER_ON_TARGET;
+	sokoban_dirty_num = 0;
+}
+
+static bool sokoban_anim_is_target(uint32_t idx){
+	for(uint32_t i = 0; i < sokoban_anim_sprite_num; i++){
+		if(sokoban_anim_sprites[i].to == idx){
+			return true;
 		}
-	}else if(*old_data == SOKOBAN_MAP_PLAYER_ON_TARGET){
-		if(*new_data == SOKOBAN_MAP_EMPTY){
-			*old_data = SOKOBAN_MAP_TARGET;
-			*new_data = SOKOBAN_MAP_PLAYER;
-		}else if(*new_data == SOKOBAN_MAP_TARGET){
-			*old_data = SOKOBAN_MAP_TARGET;
-			*new_data = SOKOBAN_MAP_PLAYER_ON_TARGET;
+	}
+	return false;
+}
+
+//one tween frame: cells of the step are cleared (except sprites that didn't move)
+//and moved sprites are drawn at pixel positions between their cells
+static void sokoban_draw_anim_frame(uint32_t frame){
+	for(uint32_t i = 0; i < sokoban_dirty_num; i++){
+		uint32_t idx = sokoban_dirty_cells[i];
+		sokoban_point_t pt = {cell_idx_to_x(idx), cell_idx_to_y(idx)};
+		char c = sokoban_anim_is_target(idx) ? SOKOBAN_MAP_EMPTY : sokoban_board_cell(&sokoban_board, pt);
+		sokoban_draw_sprite_cell(idx, c, true);
+	}
+
+	for(uint32_t i = 0; i < sokoban_anim_sprite_num; i++){
+		const sokoban_anim_sprite_t *sprite = &sokoban_anim_sprites[i];
+		sokoban_point_t to = {cell_idx_to_x(sprite->to), cell_idx_to_y(sprite->to)};
+		int32_t from_y = cell_idx_to_x(sprite->from) * CELL_SIZE;
+		int32_t from_x = cell_idx_to_y(sprite->from) * CELL_SIZE;
+		int32_t to_y = to.x * CELL_SIZE;
+		int32_t to_x = to.y * CELL_SIZE;
+
+		sokoban_draw_sprite_at(sokoban_sprite_tile(sokoban_board_cell(&sokoban_board, to)),
+			from_x + (to_x - from_x) * (int32_t)frame / SOKOBAN_ANIM_FRAMES,
+			from_y + (to_y - from_y) * (int32_t)frame / SOKOBAN_ANIM_FRAMES);
+	}
+}
+
+static void sokoban_anim_frame_time(void){
+	const lcd_frame_stats_t *frame = lcd_frame_get_stats();
+	uint32_t now = dwt_cycles();
+
+	if(sokoban_anim_frame > 1){ //first frame follows idle time
+		uint32_t us = dwt_cycles_to_us(now - sokoban_anim_last_cycles);
+		if(us < sokoban_anim_frame_min_us){
+			sokoban_anim_frame_min_us = us;
 		}
-	}else if(*old_data == SOKOBAN_MAP_STONE){
-		if(*new_data == SOKOBAN_MAP_EMPTY){
-			*old_data = SOKOBAN_MAP_EMPTY;
-			*new_data = SOKOBAN_MAP_STONE;
-		}else if(*new_data == SOKOBAN_MAP_TARGET){
-			*old_data = SOKOBAN_MAP_EMPTY;
-			*new_data = SOKOBAN_MAP_STONE_ON_TARGET;
+		if(us > sokoban_anim_frame_max_us){
+			sokoban_anim_frame_max_us = us;
 		}
-	}else if(*old_data == SOKOBAN_MAP_STONE_ON_TARGET){
-		if(*new_data == SOKOBAN_MAP_EMPTY){
-			*old_data = SOKOBAN_MAP_TARGET;
-			*new_data = SOKOBAN_MAP_STONE;
-		}else if(*new_data == SOKOBAN_MAP_TARGET){
-			*old_data = SOKOBAN_MAP_TARGET;
-			*new_data = SOKOBAN_MAP_STONE_ON_TARGET;
+		sokoban_anim_frame_sum_us += us;
+		sokoban_anim_frames++;
+
+		if(frame->vblanks - sokoban_anim_last_vblank > 1){
+			sokoban_anim_missed++;
 		}
 	}
 
-	if(redraw){
-		sokoban_draw_board(sokoban_current_level_data);
+	sokoban_anim_last_cycles = now;
+	sokoban_anim_last_vblank = frame->vblanks;
+}
+
+static void sokoban_stop_animation(void){
+	sokoban_anim_frame = 0;
+	sokoban_anim_sprite_num = 0;
+	sokoban_anim_check_end = false;
+}
+
+bool sokoban_animating(void){
+	return sokoban_anim_frame != 0;
+}
+
+void sokoban_render_frame(void){
+	if(!sokoban_animating()){
+		return;
+	}
+
+	lcd_frame_begin(false); //waits for flip of previous frame, so frames follow vblanks
+	sokoban_anim_frame_time();
+
+	if(sokoban_anim_frame < SOKOBAN_ANIM_FRAMES){
+		sokoban_draw_anim_frame(sokoban_anim_frame++);
+		sokoban_last_frame = lcd_frame_present();
+		return;
+	}
+
+	sokoban_draw_dirty_cells(); //sprites land in their cells
+	sokoban_last_frame = lcd_frame_present();
+	sokoban_last_move_pixels = sokoban_pixels_written;
+
+	bool check_end = sokoban_anim_check_end;
+	sokoban_stop_animation();
+	if(check_end){
+		check_game_end();
 	}
 }
 
+//starts animation of step in given direction starting at first, covers both the move
+//(player and pushed stone go one cell in dir) and its undo (player and pulled stone go back)
+static void sokoban_start_step(sokoban_point_t first, sokoban_dir_t dir, bool undo, bool stone, bool check_end){
+	int32_t delta_x = sokoban_dir_delta[dir][0];
+	int32_t delta_y = sokoban_dir_delta[dir][1];
+
+	uint32_t cells[3]; //first, first + delta, first + 2 * delta
+	for(int i = 0; i < 3; i++){
+		sokoban_point_t pt = {first.x + i * delta_x, first.y + i * delta_y};
+		cells[i] = sokoban_x_y_to_idx(pt);
+		if(pt.x < BOARD_HEIGHT && pt.y < BOARD_WIDTH && (i < 2 || stone)){ //third cell is touched only by the stone
+			sokoban_mark_dirty(pt);
+		}
+	}
+
+	sokoban_anim_sprites[0] = undo ? (sokoban_anim_sprite_t){cells[1], cells[0]} : (sokoban_anim_sprite_t){cells[0], cells[1]};
+	sokoban_anim_sprites[1] = undo ? (sokoban_anim_sprite_t){cells[2], cells[1]} : (sokoban_anim_sprite_t){cells[1], cells[2]};
+	sokoban_anim_sprite_num = stone ? 2 : 1;
+
+	sokoban_anim_check_end = check_end;
+	sokoban_anim_frame = 1;
+}
+
 void sokoban_move_player(uint32_t delta_x, uint32_t delta_y)
 {
 	if(!in_game){
 		return;
 	}
 
-	sokoban_point_t old_player_pos = {player.x, player.y};
-	sokoban_point_t new_player_pos = {player.x + delta_x, player.y + delta_y};
+	sokoban_pixels_written = 0;
 
-	char new_player_cell = sokoban_get_cell_value_by_pos(new_player_pos);
-	
-	if (new_player_cell == SOKOBAN_MAP_WALL || 
-		new_player_pos.x < 0 || new_player_pos.x >= BOARD_HEIGHT || 
-		new_player_pos.y < 0 || new_player_pos.y >= BOARD_WIDTH
-		){
+	sokoban_point_t old_player_pos = sokoban_board.player_pos;
+	bool deadlocked = sokoban_board.deadlocked;
+	sokoban_move_result_t result = sokoban_board_move(&sokoban_board, delta_x, delta_y);
+	if(result == SOKOBAN_MOVE_BLOCKED){
 		return;
 	}
 
-	if(new_player_cell == SOKOBAN_MAP_STONE || new_player_cell == SOKOBAN_MAP_STONE_ON_TARGET){ //push stone
-		sokoban_point_t new_stone_pos = {new_player_pos.x + delta_x, new_player_pos.y + delta_y};
-		char new_stone_cell = sokoban_get_cell_value_by_pos(new_stone_pos);
-		if(new_stone_cell == SOKOBAN_MAP_WALL || new_stone_cell == SOKOBAN_MAP_STONE){
-			return;
+	if(sokoban_board.deadlocked && !deadlocked){
+		xprintf("Deadlocked, a stone can't reach any target - undo or restart\n");
+	}
+
+	sokoban_dir_t dir = sokoban_delta_to_dir(delta_x, delta_y);
+	TRACE3("move dir %lu, result %lu, stones on target %lu", dir, result, sokoban_board.stones_on_target);
+	sokoban_history_push(&sokoban_history, dir | (result == SOKOBAN_MOVE_PUSH ? SOKOBAN_HISTORY_STEP_PUSH : 0));
+
+	sokoban_start_step(old_player_pos, dir, false, result == SOKOBAN_MOVE_PUSH, true);
+}
+
+void sokoban_undo(void){
+	uint8_t step;
+	if(!in_game || !sokoban_history_undo(&sokoban_history, &step)){
+		return;
+	}
+
+	sokoban_pixels_written = 0;
+
+	sokoban_dir_t dir = step & 3;
+	TRACE1("undo step %02lX", step);
+	sokoban_board_undo_move(&sokoban_board, dir, step & SOKOBAN_HISTORY_STEP_PUSH);
+
+	sokoban_start_step(sokoban_board.player_pos, dir, true, step & SOKOBAN_HISTORY_STEP_PUSH, false);
+}
+
+void sokoban_redo(void){
+	uint8_t step;
+	if(!in_game || !sokoban_history_redo(&sokoban_history, &step)){
+		return;
+	}
+
+	sokoban_pixels_written = 0;
+
+	sokoban_dir_t dir = step & 3;
+	TRACE1("redo step %02lX", step);
+	sokoban_point_t old_player_pos = sokoban_board.player_pos;
+	sokoban_board_move(&sokoban_board, sokoban_dir_delta[dir][0], sokoban_dir_delta[dir][1]);
+
+	sokoban_start_step(old_player_pos, dir, false, step & SOKOBAN_HISTORY_STEP_PUSH, true);
+}
+
+static bool sokoban_walkable(sokoban_point_t pt){
+	return pt.x < BOARD_HEIGHT && pt.y < BOARD_WIDTH &&
+		!sokoban_bitset_test(sokoban_board.wall, pt) && !sokoban_bitset_test(sokoban_board.stone, pt);
+}
+
+//breadth-first search from the player over cells without walls and stones,
+//stores shortest path to goal as directions in sokoban_walk_path
+static bool sokoban_find_path(sokoban_point_t goal){
+	static uint16_t queue[BOARD_CELLS];
+	static uint8_t entered[BOARD_CELLS]; //direction cell was reached with
+	sokoban_bitset_t seen = {0};
+	uint32_t head = 0, tail = 0;
+
+	sokoban_bitset_set(seen, sokoban_board.player_pos);
+	queue[tail++] = sokoban_x_y_to_idx(sokoban_board.player_pos);
+
+	uint32_t goal_idx = sokoban_x_y_to_idx(goal);
+	while(head < tail && !sokoban_bitset_test(seen, goal)){
+		uint32_t idx = queue[head++];
+		for(sokoban_dir_t dir = SOKOBAN_DIR_UP; dir <= SOKOBAN_DIR_RIGHT; dir++){
+			sokoban_point_t next = {cell_idx_to_x(idx) + sokoban_dir_delta[dir][0], cell_idx_to_y(idx) + sokoban_dir_delta[dir][1]};
+			if(sokoban_walkable(next) && !sokoban_bitset_test(seen, next)){
+				sokoban_bitset_set(seen, next);
+				entered[sokoban_x_y_to_idx(next)] = dir;
+				queue[tail++] = sokoban_x_y_to_idx(next);
+			}
 		}
+	}
+
+	if(!sokoban_bitset_test(seen, goal)){
+		return false;
+	}
 
-		update_game_data(new_player_pos, new_stone_pos, false);
+	//walk back from the goal twice, first to get path length, then to store it in order
+	uint32_t player_idx = sokoban_x_y_to_idx(sokoban_board.player_pos);
+	uint32_t len = 0;
+	for(uint32_t idx = goal_idx; idx != player_idx; len++){
+		idx -= sokoban_dir_delta[entered[idx]][0] * BOARD_WIDTH + sokoban_dir_delta[entered[idx]][1];
 	}
 
-	player = new_player_pos;
+	sokoban_walk_len = len;
+	for(uint32_t idx = goal_idx; idx != player_idx;){
+		sokoban_walk_path[--len] = entered[idx];
+		idx -= sokoban_dir_delta[entered[idx]][0] * BOARD_WIDTH + sokoban_dir_delta[entered[idx]][1];
+	}
+
+	return true;
+}
 
-	update_game_data(old_player_pos, new_player_pos, true);
+void sokoban_request_hint(void){
+	if(!in_game){
+		return;
+	}
 
-	check_game_end();
+	xprintf("Looking for a solution...\n");
+	sokoban_hint_request(&sokoban_board);
+}
+
+void sokoban_show_hint(void){
+	static sokoban_hint_t hint;
+	if(!sokoban_hint_get(&hint)){
+		return;
+	}
+
+	if(!in_game || memcmp(hint.stone, sokoban_board.stone, sizeof(hint.stone))){
+		xprintf("Hint is outdated, press h again\n");
+		return;
+	}
+
+	switch(hint.result){
+	case SOKOBAN_SOLVER_SOLVED:
+		break;
+	case SOKOBAN_SOLVER_OUT_OF_MEMORY:
+		xprintf("No solution found, solver ran out of memory\n");
+		return;
+	default:
+		xprintf("Level can't be solved from here, undo or restart\n");
+		return;
+	}
+
+	xprintf("Solution found, %lu pushes left\n", hint.push_num);
+	if(hint.push_num == 0){
+		return;
+	}
+
+	//walk behind the stone and push it
+	uint32_t cell = SOKOBAN_PUSH_CELL(hint.pushes[0]);
+	sokoban_dir_t dir = SOKOBAN_PUSH_DIR(hint.pushes[0]);
+	sokoban_point_t stand = {cell_idx_to_x(cell) - sokoban_dir_delta[dir][0], cell_idx_to_y(cell) - sokoban_dir_delta[dir][1]};
+
+	sokoban_walk_cancel();
+	if(sokoban_find_path(stand)){
+		sokoban_walk_path[sokoban_walk_len++] = dir;
+	}
+}
+
+void sokoban_walk_to(uint32_t cell_index){
+	sokoban_walk_cancel();
+	if(!in_game || cell_index >= BOARD_CELLS){
+		return;
+	}
+
+	sokoban_point_t goal = {cell_idx_to_x(cell_index), cell_idx_to_y(cell_index)};
+	int32_t delta_x = goal.x - sokoban_board.player_pos.x;
+	int32_t delta_y = goal.y - sokoban_board.player_pos.y;
+
+	if(sokoban_bitset_test(sokoban_board.stone, goal)){
+		if(abs(delta_x) + abs(delta_y) == 1){ //tap on neighbouring stone pushes it
+			sokoban_walk_path[0] = sokoban_delta_to_dir(delta_x, delta_y);
+			sokoban_walk_len = 1;
+		}
+	}else if(sokoban_walkable(goal)){
+		sokoban_find_path(goal);
+	}
+
+	TRACE2("walk to cell %lu, %lu steps", cell_index, sokoban_walk_len);
+}
+
+bool sokoban_walking(void){
+	return sokoban_walk_pos < sokoban_walk_len;
+}
+
+void sokoban_walk_step(void){
+	if(!sokoban_walking()){
+		return;
+	}
+
+	if(!in_game){
+		sokoban_walk_cancel();
+		return;
+	}
+
+	sokoban_dir_t dir = sokoban_walk_path[sokoban_walk_pos++];
+	sokoban_move_player(sokoban_dir_delta[dir][0], sokoban_dir_delta[dir][1]);
+}
+
+void sokoban_walk_cancel(void){
+	sokoban_walk_len = 0;
+	sokoban_walk_pos = 0;
 }
 
 void sokoban_spacebar_handler(void){
@@ -232,39 +630,51 @@ void sokoban_spacebar_handler(void){
 }
 
 static void sokoban_clear_both_screens(){
-	BSP_LCD_SelectLayer(LCD_LAYER_BG);
-	BSP_LCD_Clear(LCD_COLOR_WHITE);
-	BSP_LCD_SelectLayer(LCD_LAYER_FG);
-	BSP_LCD_Clear(LCD_COLOR_WHITE);
+	lcd_frame_begin(true);
+	sokoban_clear_layer(LCD_LAYER_BG, LCD_COLOR_WHITE);
+	sokoban_clear_layer(LCD_LAYER_FG, LCD_COLOR_WHITE);
 }
 
 static void sokoban_new_game_splashscreen(){
 	sokoban_clear_both_screens();
 
-	BSP_LCD_SetTextColor(LCD_COLOR_BLACK);
-	BSP_LCD_DisplayStringAt(0, 100, (uint8_t *)"Level finished", CENTER_MODE);
-	BSP_LCD_DisplayStringAt(0, 200, (uint8_t *)"Space to continue!", CENTER_MODE);
+	lcd_text_display_at(LCD_LAYER_FG, 0, 100, "Level finished", CENTER_MODE, LCD_COLOR_BLACK);
+	lcd_text_display_at(LCD_LAYER_FG, 0, 200, "Space to continue!", CENTER_MODE, LCD_COLOR_BLACK);
+	sokoban_last_frame = lcd_frame_present();
 }
 
 static void sokoban_end_game_splashscreen(){
 	sokoban_clear_both_screens();
 
-	BSP_LCD_SetTextColor(LCD_COLOR_BLACK);
-	BSP_LCD_DisplayStringAt(0, 100, (uint8_t *)"Game finished", CENTER_MODE);
-	BSP_LCD_DisplayStringAt(0, 200, (uint8_t *)"Space to restart game!", CENTER_MODE);
+	lcd_text_display_at(LCD_LAYER_FG, 0, 100, "Game finished", CENTER_MODE, LCD_COLOR_BLACK);
+	lcd_text_display_at(LCD_LAYER_FG, 0, 200, "Space to restart game!", CENTER_MODE, LCD_COLOR_BLACK);
+	sokoban_last_frame = lcd_frame_present();
 }
 
 static void check_game_end(void){
-	uint32_t valid_stones = char_occurences(sokoban_current_level_data, SOKOBAN_MAP_STONE_ON_TARGET);
+#ifdef SOKOBAN_DEBUG
+	uint32_t scanned = sokoban_board_scan_on_target(&sokoban_board);
+	if(scanned != sokoban_board.stones_on_target){
+		xprintf(ANSI_FG_RED "stones on target mismatch: counter %lu, scan %lu" ANSI_FG_DEFAULT "\n", sokoban_board.stones_on_target, scanned);
+	}
+	if(sokoban_board_scan_hash(&sokoban_board) != sokoban_board.hash){
+		xprintf(ANSI_FG_RED "board hash mismatch" ANSI_FG_DEFAULT "\n");
+	}
+#endif
 
-	if(valid_stones != sokoban_target_num){
+	if(sokoban_board.stones_on_target != sokoban_target_num){
 		return;
 	}
 
 	in_game = false;
 
-	osDelay(800);
-	sokoban_clear_level();
+	if(sokoban_board_indexed()){ //flash whole background without redraw
+		lcd_frame_load_clut(LCD_LAYER_BG, sokoban_flash_clut, SOKOBAN_CLUT_SIZE);
+		osDelay(800);
+		sokoban_load_theme();
+	}else{
+		osDelay(800);
+	}
 	
 	sokoban_current_level += 1;
 	if(sokoban_current_level >= total_levels){
@@ -274,3 +684,145 @@ static void check_game_end(void){
 		sokoban_new_game_splashscreen();
 	}
 }
+
+void sokoban_print_stats(void){
+	xprintf("pixels written: last move %lu, full board %lu\n", sokoban_last_move_pixels, sokoban_board_draw_pixels);
+	xprintf("board hash: %08lX%08lX\n", (uint32_t)(sokoban_board.hash >> 32), (uint32_t)sokoban_board.hash);
+
+	if(sokoban_cell_draw_num){
+		xprintf("cell draw (CPU side): avg %lu cycles, max %lu cycles (%lu cells)\n",
+			sokoban_cell_draw_cycles / sokoban_cell_draw_num, sokoban_cell_draw_max_cycles, sokoban_cell_draw_num);
+	}
+
+	const lcd_frame_stats_t *frame = lcd_frame_get_stats();
+	xprintf("frames: last %lu, shown %lu, vblanks %lu, missed vblanks %lu, max latency %lu vblanks\n",
+		sokoban_last_frame, frame->flips, frame->vblanks, frame->missed, frame->max_latency);
+	xprintf("back buffer refresh: %lu full copies, %lu rectangles\n", frame->full_copies, frame->rect_copies);
+	xprintf("damage: last frame %lu rectangles %lu pixels, max %lu pixels, total %lu rectangles %lu pixels\n",
+		frame->last_rects, frame->last_pixels, frame->max_pixels, frame->total_rects, frame->total_pixels);
+
+	if(sokoban_anim_frames){
+		xprintf("animation: %lu frames, frame time min %lu us, avg %lu us, max %lu us, missed %lu\n",
+			sokoban_anim_frames, sokoban_anim_frame_min_us, sokoban_anim_frame_sum_us / sokoban_anim_frames,
+			sokoban_anim_frame_max_us, sokoban_anim_missed);
+	}
+
+	const dma2d_queue_stats_t *dma2d = dma2d_queue_get_stats();
+	xprintf("DMA2D queue: %lu jobs, max depth %lu, waits for free slot %lu, errors %lu\n",
+		dma2d->jobs, dma2d->max_depth, dma2d->full_waits, dma2d->errors);
+
+	if(sokoban_pack_is_open()){
+		const sokoban_pack_stats_t *pack = sokoban_pack_get_stats();
+		xprintf("level pack: %lu levels, index %s in %lu us, level load last %lu us, max %lu us\n",
+			pack->index_levels, pack->index_rebuilt ? "built" : "loaded", pack->index_build_us,
+			pack->last_load_us, pack->max_load_us);
+	}
+
+	const sokoban_hint_stats_t *hint = sokoban_hint_get_stats();
+	if(hint->requests){
+		xprintf("solver: %lu requests, %lu solved, %lu unsolvable, %lu out of memory, %lu cancelled\n", hint->requests,
+			hint->results[SOKOBAN_SOLVER_SOLVED], hint->results[SOKOBAN_SOLVER_UNSOLVABLE],
+			hint->results[SOKOBAN_SOLVER_OUT_OF_MEMORY], hint->results[SOKOBAN_SOLVER_CANCELLED]);
+		xprintf("solver: last search %lu nodes in %lu ms (%lu nodes/s), peak table %lu/%lu nodes, peak open list %lu\n",
+			hint->last_expanded, hint->last_ms, hint->last_nodes_per_sec, hint->peak_nodes, hint->capacity, hint->peak_open);
+		xprintf("solver: last search dropped %lu deadlocked pushes, repaired heuristic %lu times, forgot %lu nodes\n",
+			hint->last_deadlocks, hint->last_repairs, hint->last_evicted);
+		xprintf("solver: table of %lu KB, %lu bytes per node\n", hint->memory / 1024, hint->node_bytes);
+	}
+}
+
+//compares drawing the player cell with BSP primitives (as done before the sprite atlas)
+//and with atlas copy, the cell is repainted from the atlas at the end
+void sokoban_benchmark_cell_draw(void){
+	const uint32_t rounds = 100;
+
+	if(!in_game){
+		return;
+	}
+
+	uint32_t cell_index = sokoban_x_y_to_idx(sokoban_board.player_pos);
+	uint32_t y = cell_idx_to_x(cell_index) * CELL_SIZE;
+	uint32_t x = cell_idx_to_y(cell_index) * CELL_SIZE;
+
+	lcd_frame_begin(false);
+	dma2d_queue_flush();
+	BSP_LCD_SelectLayer(LCD_LAYER_FG);
+	uint32_t start = dwt_cycles();
+	for(uint32_t i = 0; i < rounds; i++){
+		BSP_LCD_SetTextColor(lcd_frame_color(LCD_LAYER_FG, SOKOBAN_TRANSPARENT_COLOR));
+		BSP_LCD_FillRect(x, y, CELL_SIZE, CELL_SIZE);
+		BSP_LCD_SetTextColor(lcd_frame_color(LCD_LAYER_FG, SOKOBAN_PLAYER_COLOR));
+		BSP_LCD_FillCircle(x + HALF_CELL_SIZE, y + HALF_CELL_SIZE, HALF_CELL_SIZE - 1);
+	}
+	uint32_t bsp_cycles = (dwt_cycles() - start) / rounds;
+
+	start = dwt_cycles();
+	for(uint32_t i = 0; i < rounds; i++){
+		sokoban_atlas_draw(SOKOBAN_TILE_PLAYER, LCD_LAYER_FG, x, y);
+	}
+	uint32_t submit_cycles = (dwt_cycles() - start) / rounds;
+	dma2d_queue_flush();
+	uint32_t atlas_cycles = (dwt_cycles() - start) / rounds;
+
+	lcd_frame_damage(LCD_LAYER_FG, x, y, CELL_SIZE, CELL_SIZE);
+	sokoban_last_frame = lcd_frame_present();
+
+	xprintf("player cell draw: BSP primitives %lu cycles (%lu us), atlas %lu cycles (%lu us), CPU busy %lu cycles\n",
+		bsp_cycles, dwt_cycles_to_us(bsp_cycles), atlas_cycles, dwt_cycles_to_us(atlas_cycles), submit_cycles);
+}
+
+//both layers are cleared and then the board is redrawn, times include waiting for DMA2D
+void sokoban_benchmark_redraw(void){
+	uint32_t screen_pixels = BSP_LCD_GetXSize() * BSP_LCD_GetYSize();
+	uint32_t screen_bytes = screen_pixels * (lcd_frame_bytes_per_pixel(LCD_LAYER_BG) + lcd_frame_bytes_per_pixel(LCD_LAYER_FG));
+
+	lcd_frame_begin(true);
+	uint32_t start = dwt_cycles();
+	sokoban_clear_layer(LCD_LAYER_BG, SOKOBAN_BACKGROUND_COLOR);
+	sokoban_clear_layer(LCD_LAYER_FG, SOKOBAN_TRANSPARENT_COLOR);
+	dma2d_queue_flush();
+	uint32_t clear_cycles = dwt_cycles() - start;
+	sokoban_last_frame = lcd_frame_present();
+
+	lcd_frame_wait();
+	start = dwt_cycles();
+	sokoban_draw_board();
+	uint32_t board_cycles = dwt_cycles() - start;
+
+	xprintf("%lu bytes in both layers: clear %lu us, board redraw %lu us\n",
+		screen_bytes, dwt_cycles_to_us(clear_cycles), dwt_cycles_to_us(board_cycles));
+}
+
+//compares splash screen string drawn by BSP (pixel by pixel) and from glyph cache,
+//both go to the back buffer which is repainted afterwards
+void sokoban_benchmark_text(void){
+	const uint32_t rounds = 10;
+	const char *text = "Space to restart game!";
+
+	if(!in_game){
+		return;
+	}
+
+	lcd_frame_wait();
+
+	BSP_LCD_SelectLayer(LCD_LAYER_FG);
+	BSP_LCD_SetTextColor(lcd_frame_color(LCD_LAYER_FG, LCD_COLOR_BLACK));
+	uint32_t start = dwt_cycles();
+	for(uint32_t i = 0; i < rounds; i++){
+		BSP_LCD_DisplayStringAt(0, 200, (uint8_t *)text, CENTER_MODE);
+	}
+	uint32_t bsp_cycles = (dwt_cycles() - start) / rounds;
+
+	start = dwt_cycles();
+	for(uint32_t i = 0; i < rounds; i++){
+		lcd_text_display_at(LCD_LAYER_FG, 0, 200, text, CENTER_MODE, LCD_COLOR_BLACK);
+	}
+	uint32_t submit_cycles = (dwt_cycles() - start) / rounds;
+	dma2d_queue_flush();
+	uint32_t cache_cycles = (dwt_cycles() - start) / rounds;
+
+	xprintf("string of %lu chars: BSP %lu us, glyph cache %lu us, CPU busy %lu us\n", (uint32_t)strlen(text),
+		dwt_cycles_to_us(bsp_cycles), dwt_cycles_to_us(cache_cycles), dwt_cycles_to_us(submit_cycles));
+
+	sokoban_draw_board();
+}
@@ -0,0 +1,97 @@
+#include <sokoban_atlas.h>
+#include <stdbool.h>
+
+#include "sokoban.h"
+#include "lcd_frame.h"
+
+#define TILE_PIXELS                      (CELL_SIZE * CELL_SIZE)
+
+extern LTDC_HandleTypeDef hLtdcHandler;
+
+//tiles are kept in pixel format of the layer they are drawn on, rows are sized for ARGB8888
+static uint32_t sokoban_atlas[SOKOBAN_TILE_NUM][TILE_PIXELS] __attribute__((section(".sdram")));
+static uint32_t atlas_layer[SOKOBAN_TILE_NUM];
+static uint32_t atlas_format[SOKOBAN_TILE_NUM];
+static bool atlas_ready = false;
+
+static void atlas_set_pixel(sokoban_tile_t tile, uint32_t i, uint32_t color){
+	color = lcd_frame_color(atlas_layer[tile], color);
+
+	switch(lcd_frame_bytes_per_pixel(atlas_layer[tile])){
+	case 4:
+		sokoban_atlas[tile][i] = color;
+		break;
+	case 2:
+		((uint16_t *)sokoban_atlas[tile])[i] = color;
+		break;
+	default:
+		((uint8_t *)sokoban_atlas[tile])[i] = color;
+		break;
+	}
+}
+
+static void atlas_fill(sokoban_tile_t tile, uint32_t color){
+	for(int i = 0; i < TILE_PIXELS; i++){
+		atlas_set_pixel(tile, i, color);
+	}
+}
+
+//same footprint as BSP_LCD_FillCircle centered in the cell
+static void atlas_circle(sokoban_tile_t tile, uint32_t radius, uint32_t color){
+	for(int y = 0; y < CELL_SIZE; y++){
+		for(int x = 0; x < CELL_SIZE; x++){
+			int dx = x - HALF_CELL_SIZE;
+			int dy = y - HALF_CELL_SIZE;
+			if(dx * dx + dy * dy <= radius * radius + radius){
+				atlas_set_pixel(tile, y * CELL_SIZE + x, color);
+			}
+		}
+	}
+}
+
+static bool atlas_formats_match(void){
+	for(int tile = 0; tile < SOKOBAN_TILE_NUM; tile++){
+		if(atlas_format[tile] != hLtdcHandler.LayerCfg[atlas_layer[tile]].PixelFormat){
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void sokoban_atlas_init(uint32_t bg_layer, uint32_t fg_layer){
+	for(int tile = 0; tile < SOKOBAN_TILE_NUM; tile++){
+		atlas_layer[tile] = (tile < SOKOBAN_TILE_NONE) ? bg_layer : fg_layer;
+	}
+
+	if(atlas_ready && atlas_formats_match()){
+		return;
+	}
+
+	for(int tile = 0; tile < SOKOBAN_TILE_NUM; tile++){
+		atlas_format[tile] = hLtdcHandler.LayerCfg[atlas_layer[tile]].PixelFormat;
+	}
+
+	atlas_fill(SOKOBAN_TILE_WALL, SOKOBAN_WALL_COLOR);
+	atlas_fill(SOKOBAN_TILE_TARGET, SOKOBAN_TARGET_COLOR);
+	atlas_fill(SOKOBAN_TILE_NONE, SOKOBAN_TRANSPARENT_COLOR);
+
+	atlas_fill(SOKOBAN_TILE_PLAYER, SOKOBAN_TRANSPARENT_COLOR);
+	atlas_circle(SOKOBAN_TILE_PLAYER, HALF_CELL_SIZE - 1, SOKOBAN_PLAYER_COLOR);
+
+	atlas_fill(SOKOBAN_TILE_PLAYER_DEADLOCKED, SOKOBAN_TRANSPARENT_COLOR);
+	atlas_circle(SOKOBAN_TILE_PLAYER_DEADLOCKED, HALF_CELL_SIZE - 1, SOKOBAN_DEADLOCK_COLOR);
+
+	atlas_fill(SOKOBAN_TILE_STONE, SOKOBAN_TRANSPARENT_COLOR);
+	atlas_circle(SOKOBAN_TILE_STONE, HALF_CELL_SIZE - 3, SOKOBAN_STONE_COLOR);
+
+	atlas_fill(SOKOBAN_TILE_STONE_ON_TARGET, SOKOBAN_TRANSPARENT_COLOR);
+	atlas_circle(SOKOBAN_TILE_STONE_ON_TARGET, HALF_CELL_SIZE - 3, SOKOBAN_DONE_COLOR);
+
+	atlas_ready = true;
+}
+
+//copy is only queued
+void sokoban_atlas_draw(sokoban_tile_t tile, uint32_t layer, uint32_t x, uint32_t y){
+	lcd_frame_copy(layer, (uint32_t)sokoban_atlas[tile], x, y, CELL_SIZE, CELL_SIZE);
+}
@@ -0,0 +1,287 @@
+#include <sokoban_board.h>
+#include <string.h>
+
+const int32_t sokoban_dir_delta[4][2] = {
+	[SOKOBAN_DIR_UP]    = {-1, 0},
+	[SOKOBAN_DIR_DOWN]  = {1, 0},
+	[SOKOBAN_DIR_LEFT]  = {0, -1},
+	[SOKOBAN_DIR_RIGHT] = {0, 1},
+};
+
+uint64_t sokoban_zobrist_stone[BOARD_CELLS];
+uint64_t sokoban_zobrist_player[BOARD_CELLS];
+
+//splitmix64, spreads a single seed into well mixed keys
+static uint64_t zobrist_next(uint64_t *state){
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+void sokoban_board_init_zobrist(uint64_t seed){
+	for(uint32_t idx = 0; idx < BOARD_CELLS; idx++){
+		sokoban_zobrist_stone[idx] = zobrist_next(&seed);
+		sokoban_zobrist_player[idx] = zobrist_next(&seed);
+	}
+}
+
+static uint32_t bitset_count(const uint32_t *set){
+	uint32_t cnt = 0;
+	for(int i = 0; i < BOARD_HEIGHT; i++){
+		cnt += __builtin_popcount(set[i]);
+	}
+
+	return cnt;
+}
+
+static bool is_inside(sokoban_point_t pt){
+	return pt.x < BOARD_HEIGHT && pt.y < BOARD_WIDTH; //negative coordinates wrap around
+}
+
+static bool is_wall(const sokoban_board_t *board, sokoban_point_t pt){
+	return !is_inside(pt) || sokoban_bitset_test(board->wall, pt);
+}
+
+//stones are pulled back from every target, cells no pull reaches are dead;
+//a pull moves the stone towards the player, which needs a free cell behind it
+static void compute_dead(sokoban_board_t *board){
+	static sokoban_point_t queue[BOARD_CELLS];
+	sokoban_bitset_t live;
+	uint32_t head = 0, tail = 0;
+
+	memcpy(live, board->target, sizeof(live));
+	for(uint32_t idx = 0; idx < BOARD_CELLS; idx++){
+		sokoban_point_t pt = {idx / BOARD_WIDTH, idx % BOARD_WIDTH};
+		if(sokoban_bitset_test(board->target, pt)){
+			queue[tail++] = pt;
+		}
+	}
+
+	while(head < tail){
+		sokoban_point_t pt = queue[head++];
+		for(sokoban_dir_t dir = SOKOBAN_DIR_UP; dir <= SOKOBAN_DIR_RIGHT; dir++){
+			sokoban_point_t to = {pt.x + sokoban_dir_delta[dir][0], pt.y + sokoban_dir_delta[dir][1]};
+			sokoban_point_t player = {to.x + sokoban_dir_delta[dir][0], to.y + sokoban_dir_delta[dir][1]};
+			if(!is_wall(board, to) && !is_wall(board, player) && !sokoban_bitset_test(live, to)){
+				sokoban_bitset_set(live, to);
+				queue[tail++] = to;
+			}
+		}
+	}
+
+	for(int i = 0; i < BOARD_HEIGHT; i++){
+		board->dead[i] = ~(live[i] | board->wall[i]) & ((1u << BOARD_WIDTH) - 1);
+	}
+}
+
+void sokoban_board_load(sokoban_board_t *board, const char *data_level){
+	memset(board, 0, sizeof(*board));
+
+	for(uint32_t idx = 0; idx < BOARD_CELLS && data_level[idx]; idx++){
+		sokoban_point_t pt = {idx / BOARD_WIDTH, idx % BOARD_WIDTH};
+
+		switch(data_level[idx]){
+		case SOKOBAN_MAP_WALL:
+			sokoban_bitset_set(board->wall, pt);
+			break;
+
+		case SOKOBAN_MAP_PLAYER_ON_TARGET:
+			sokoban_bitset_set(board->target, pt);
+			//fallthrough
+		case SOKOBAN_MAP_PLAYER:
+			sokoban_bitset_set(board->player, pt);
+			board->player_pos = pt;
+			break;
+
+		case SOKOBAN_MAP_STONE_ON_TARGET:
+			sokoban_bitset_set(board->target, pt);
+			//fallthrough
+		case SOKOBAN_MAP_STONE:
+			sokoban_bitset_set(board->stone, pt);
+			break;
+
+		case SOKOBAN_MAP_TARGET:
+			sokoban_bitset_set(board->target, pt);
+			break;
+		}
+	}
+
+	board->target_num = bitset_count(board->target);
+	board->stones_on_target = sokoban_board_scan_on_target(board);
+	board->hash = sokoban_board_scan_hash(board);
+
+	compute_dead(board);
+	board->deadlocked = sokoban_board_scan_deadlock(board);
+}
+
+//moves single piece (player or stone bitset) between cells
+static void update_game_data(sokoban_board_t *board, uint32_t *set, sokoban_point_t old, sokoban_point_t new){
+	sokoban_bitset_clear(set, old);
+	sokoban_bitset_set(set, new);
+
+	uint32_t old_idx = old.x * BOARD_WIDTH + old.y;
+	uint32_t new_idx = new.x * BOARD_WIDTH + new.y;
+	if(set == board->stone){
+		board->stones_on_target -= sokoban_bitset_test(board->target, old);
+		board->stones_on_target += sokoban_bitset_test(board->target, new);
+		board->hash ^= sokoban_zobrist_stone[old_idx] ^ sokoban_zobrist_stone[new_idx];
+	}else{
+		board->hash ^= sokoban_zobrist_player[old_idx] ^ sokoban_zobrist_player[new_idx];
+	}
+}
+
+sokoban_move_result_t sokoban_board_move(sokoban_board_t *board, int32_t delta_x, int32_t delta_y){
+	sokoban_point_t old_player_pos = board->player_pos;
+	sokoban_point_t new_player_pos = {old_player_pos.x + delta_x, old_player_pos.y + delta_y};
+
+	if(!is_inside(new_player_pos)){
+		return SOKOBAN_MOVE_BLOCKED;
+	}
+
+	uint32_t row = new_player_pos.x;
+	uint32_t bit = 1u << new_player_pos.y;
+
+	if(board->wall[row] & bit){
+		return SOKOBAN_MOVE_BLOCKED;
+	}
+
+	sokoban_move_result_t result = SOKOBAN_MOVE_WALK;
+
+	if(board->stone[row] & bit){ //push stone
+		sokoban_point_t new_stone_pos = {new_player_pos.x + delta_x, new_player_pos.y + delta_y};
+		if(!is_inside(new_stone_pos)){
+			return SOKOBAN_MOVE_BLOCKED;
+		}
+
+		uint32_t stone_row = new_stone_pos.x;
+		if((board->wall[stone_row] | board->stone[stone_row]) & (1u << new_stone_pos.y)){
+			return SOKOBAN_MOVE_BLOCKED;
+		}
+
+		update_game_data(board, board->stone, new_player_pos, new_stone_pos);
+		board->deadlocked |= sokoban_board_stone_deadlocked(board, new_stone_pos); //stays once it happens
+		result = SOKOBAN_MOVE_PUSH;
+	}
+
+	update_game_data(board, board->player, old_player_pos, new_player_pos);
+	board->player_pos = new_player_pos;
+
+	return result;
+}
+
+void sokoban_board_undo_move(sokoban_board_t *board, sokoban_dir_t dir, bool push){
+	int32_t delta_x = sokoban_dir_delta[dir][0];
+	int32_t delta_y = sokoban_dir_delta[dir][1];
+
+	sokoban_point_t player_pos = board->player_pos;
+	sokoban_point_t old_player_pos = {player_pos.x - delta_x, player_pos.y - delta_y};
+
+	update_game_data(board, board->player, player_pos, old_player_pos);
+	board->player_pos = old_player_pos;
+
+	if(push){
+		sokoban_point_t stone_pos = {player_pos.x + delta_x, player_pos.y + delta_y};
+		update_game_data(board, board->stone, stone_pos, player_pos);
+		board->deadlocked = sokoban_board_scan_deadlock(board);
+	}
+}
+
+sokoban_dir_t sokoban_delta_to_dir(int32_t delta_x, int32_t delta_y){
+	if(delta_x){
+		return delta_x < 0 ? SOKOBAN_DIR_UP : SOKOBAN_DIR_DOWN;
+	}
+
+	return delta_y < 0 ? SOKOBAN_DIR_LEFT : SOKOBAN_DIR_RIGHT;
+}
+
+uint32_t sokoban_board_scan_on_target(const sokoban_board_t *board){
+	uint32_t cnt = 0;
+	for(int i = 0; i < BOARD_HEIGHT; i++){
+		cnt += __builtin_popcount(board->stone[i] & board->target[i]);
+	}
+
+	return cnt;
+}
+
+static bool is_frozen(const sokoban_board_t *board, sokoban_point_t pt, uint32_t *checked, bool *off_target);
+
+//stone can't move along axis given by dir when a wall or an already checked stone is on either side,
+//when both sides are dead cells, or when a stone on either side is frozen itself
+static bool is_blocked(const sokoban_board_t *board, sokoban_point_t pt, sokoban_dir_t dir, uint32_t *checked, bool *off_target){
+	sokoban_point_t a = {pt.x + sokoban_dir_delta[dir][0], pt.y + sokoban_dir_delta[dir][1]};
+	sokoban_point_t b = {pt.x - sokoban_dir_delta[dir][0], pt.y - sokoban_dir_delta[dir][1]};
+
+	if(is_wall(board, a) || is_wall(board, b) || sokoban_bitset_test(checked, a) || sokoban_bitset_test(checked, b)){
+		return true;
+	}
+	if(sokoban_bitset_test(board->dead, a) && sokoban_bitset_test(board->dead, b)){
+		return true;
+	}
+
+	return (sokoban_bitset_test(board->stone, a) && is_frozen(board, a, checked, off_target)) ||
+		(sokoban_bitset_test(board->stone, b) && is_frozen(board, b, checked, off_target));
+}
+
+//checked stones are treated as walls, so neighbours blocking each other end the recursion
+static bool is_frozen(const sokoban_board_t *board, sokoban_point_t pt, uint32_t *checked, bool *off_target){
+	sokoban_bitset_set(checked, pt);
+
+	bool frozen = is_blocked(board, pt, SOKOBAN_DIR_DOWN, checked, off_target) &&
+		is_blocked(board, pt, SOKOBAN_DIR_RIGHT, checked, off_target);
+	if(!frozen){
+		sokoban_bitset_clear(checked, pt); //a stone which can move mustn't block others
+	}else if(!sokoban_bitset_test(board->target, pt)){
+		*off_target = true;
+	}
+
+	return frozen;
+}
+
+bool sokoban_board_stone_deadlocked(const sokoban_board_t *board, sokoban_point_t stone){
+	if(sokoban_bitset_test(board->dead, stone)){
+		return true;
+	}
+
+	sokoban_bitset_t checked = {0};
+	bool off_target = false;
+	return is_frozen(board, stone, checked, &off_target) && off_target;
+}
+
+bool sokoban_board_scan_deadlock(const sokoban_board_t *board){
+	for(int i = 0; i < BOARD_HEIGHT; i++){
+		for(uint32_t bits = board->stone[i] & ~board->target[i]; bits; bits &= bits - 1){
+			sokoban_point_t pt = {i, __builtin_ctz(bits)};
+			if(sokoban_board_stone_deadlocked(board, pt)){
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+uint64_t sokoban_board_scan_hash(const sokoban_board_t *board){
+	uint64_t hash = sokoban_zobrist_player[board->player_pos.x * BOARD_WIDTH + board->player_pos.y];
+	for(int i = 0; i < BOARD_HEIGHT; i++){
+		for(uint32_t bits = board->stone[i]; bits; bits &= bits - 1){
+			hash ^= sokoban_zobrist_stone[i * BOARD_WIDTH + __builtin_ctz(bits)];
+		}
+	}
+
+	return hash;
+}
+
+char sokoban_board_cell(const sokoban_board_t *board, sokoban_point_t pt){
+	bool target = sokoban_bitset_test(board->target, pt);
+
+	if(sokoban_bitset_test(board->wall, pt)){
+		return SOKOBAN_MAP_WALL;
+	}else if(sokoban_bitset_test(board->player, pt)){
+		return target ? SOKOBAN_MAP_PLAYER_ON_TARGET : SOKOBAN_MAP_PLAYER;
+	}else if(sokoban_bitset_test(board->stone, pt)){
+		return target ? SOKOBAN_MAP_STONE_ON_TARGET : SOKOBAN_MAP_STONE;
+	}
+
+	return target ? SOKOBAN_MAP_TARGET : SOKOBAN_MAP_EMPTY;
+}
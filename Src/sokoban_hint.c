@@ -0,0 +1,97 @@
+#include <sokoban_hint.h>
+#include <string.h>
+
+#include "cmsis_os.h"
+#include "queue.h"
+#include "input_queue.h"
+#include "dwt.h"
+#include "trace.h"
+
+//defined by the linker script, SDRAM left after framebuffers, atlas and glyphs
+extern uint8_t _sdram_end[];
+extern uint8_t _sdram_limit[];
+
+static sokoban_solver_t solver;
+static sokoban_hint_t hint;
+static sokoban_hint_stats_t stats;
+
+static QueueHandle_t request_queue;
+static QueueHandle_t result_queue;
+static uint32_t slice_start;
+
+//called by the solver between expansions, gives up when newer board is waiting
+//and sleeps a tick after every slice, so even the idle task isn't starved
+static bool sokoban_hint_poll(void){
+	if(uxQueueMessagesWaiting(request_queue)){
+		return false;
+	}
+
+	if(dwt_cycles() - slice_start > SOKOBAN_HINT_SLICE_MS * (SystemCoreClock / 1000)){
+		osDelay(1);
+		slice_start = dwt_cycles();
+	}
+	return true;
+}
+
+static void sokoban_hint_task(void const *argument){
+	static sokoban_board_t board;
+
+	for(;;){
+		xQueueReceive(request_queue, &board, portMAX_DELAY);
+
+		TickType_t start = xTaskGetTickCount();
+		slice_start = dwt_cycles();
+		hint.result = sokoban_solver_solve(&solver, &board, hint.pushes, SOKOBAN_HINT_MAX_PUSHES, &hint.push_num, sokoban_hint_poll);
+		uint32_t ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+
+		const sokoban_solver_stats_t *s = &solver.stats;
+		TRACE3("solver result %lu, %lu expanded, %lu stored", hint.result, s->expanded, s->nodes);
+		stats.results[hint.result]++;
+		stats.last_expanded = s->expanded;
+		stats.last_deadlocks = s->deadlocks;
+		stats.last_repairs = s->repairs;
+		stats.last_evicted = s->evicted;
+		stats.capacity = s->capacity;
+		stats.node_bytes = s->node_bytes;
+		stats.last_ms = ms;
+		stats.last_nodes_per_sec = ms ? (uint32_t)((uint64_t)s->expanded * 1000 / ms) : 0;
+		if(s->nodes > stats.peak_nodes){
+			stats.peak_nodes = s->nodes;
+		}
+		if(s->max_open > stats.peak_open){
+			stats.peak_open = s->max_open;
+		}
+
+		if(hint.result == SOKOBAN_SOLVER_CANCELLED){
+			continue; //newer request is waiting
+		}
+
+		memcpy(hint.stone, board.stone, sizeof(hint.stone));
+		xQueueOverwrite(result_queue, &hint);
+		input_queue_post(INPUT_SOURCE_SOLVER, INPUT_KEY_PRESS, INPUT_KEY_HINT, 0, dwt_cycles());
+	}
+}
+
+void sokoban_hint_start(void){
+	stats.memory = _sdram_limit - _sdram_end;
+	sokoban_solver_init(&solver, _sdram_end, stats.memory);
+
+	request_queue = xQueueCreate(1, sizeof(sokoban_board_t));
+	result_queue = xQueueCreate(1, sizeof(sokoban_hint_t));
+
+	osThreadDef(hintTask, sokoban_hint_task, osPriorityLow, 0, 1024);
+	osThreadCreate(osThread(hintTask), NULL);
+}
+
+void sokoban_hint_request(const sokoban_board_t *board){
+	stats.requests++;
+	xQueueOverwrite(request_queue, board);
+}
+
+bool sokoban_hint_get(sokoban_hint_t *result){
+	return xQueueReceive(result_queue, result, 0) == pdTRUE;
+}
+
+const sokoban_hint_stats_t *sokoban_hint_get_stats(void){
+	return &stats;
+}
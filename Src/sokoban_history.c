@@ -0,0 +1,69 @@
+#include <sokoban_history.h>
+
+#define STEP_MASK                        ((1 << SOKOBAN_HISTORY_STEP_BITS) - 1)
+
+//SOKOBAN_HISTORY_BYTES holds whole number of steps, so a step never wraps around buffer end
+static uint8_t history_read(const sokoban_history_t *history, uint32_t pos){
+	uint32_t bit = (pos % SOKOBAN_HISTORY_STEPS) * SOKOBAN_HISTORY_STEP_BITS;
+	uint32_t byte = bit / 8;
+	uint32_t window = history->data[byte];
+
+	if(bit % 8 > 8 - SOKOBAN_HISTORY_STEP_BITS){
+		window |= history->data[byte + 1] << 8;
+	}
+
+	return (window >> (bit % 8)) & STEP_MASK;
+}
+
+static void history_write(sokoban_history_t *history, uint32_t pos, uint8_t step){
+	uint32_t bit = (pos % SOKOBAN_HISTORY_STEPS) * SOKOBAN_HISTORY_STEP_BITS;
+	uint32_t byte = bit / 8;
+	uint32_t shift = bit % 8;
+
+	history->data[byte] = (history->data[byte] & ~(STEP_MASK << shift)) | (step << shift);
+
+	if(shift > 8 - SOKOBAN_HISTORY_STEP_BITS){
+		history->data[byte + 1] = (history->data[byte + 1] & ~(STEP_MASK >> (8 - shift))) | (step >> (8 - shift));
+	}
+}
+
+void sokoban_history_clear(sokoban_history_t *history){
+	history->first = 0;
+	history->count = 0;
+	history->redo = 0;
+}
+
+void sokoban_history_push(sokoban_history_t *history, uint8_t step){
+	history_write(history, history->first + history->count, step & STEP_MASK);
+	history->redo = 0;
+
+	if(history->count < SOKOBAN_HISTORY_STEPS){
+		history->count++;
+	}else{
+		history->first = (history->first + 1) % SOKOBAN_HISTORY_STEPS;
+	}
+}
+
+bool sokoban_history_undo(sokoban_history_t *history, uint8_t *step){
+	if(history->count == 0){
+		return false;
+	}
+
+	history->count--;
+	history->redo++;
+	*step = history_read(history, history->first + history->count);
+
+	return true;
+}
+
+bool sokoban_history_redo(sokoban_history_t *history, uint8_t *step){
+	if(history->redo == 0){
+		return false;
+	}
+
+	*step = history_read(history, history->first + history->count);
+	history->count++;
+	history->redo--;
+
+	return true;
+}
@@ -0,0 +1,369 @@
+#include <sokoban_pack.h>
+#include <string.h>
+
+#include "dwt.h"
+#include "trace.h"
+
+//sidecar index file, one entry per level placed after the header
+#define PACK_INDEX_MAGIC                 0x58444953 //"SIDX"
+#define PACK_INDEX_VERSION               1
+#define PACK_INDEX_SUFFIX                ".idx"
+
+typedef struct{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t pack_size;
+	uint32_t pack_mtime; //fdate << 16 | ftime of the pack
+	uint32_t level_num;
+} pack_index_header_t;
+
+typedef struct{
+	uint32_t offset; //first board line of the level
+	uint8_t width;
+	uint8_t height;
+	uint16_t reserved;
+} pack_index_entry_t;
+
+static FIL pack_file;
+static bool pack_open = false;
+static uint32_t pack_level_num = 0;
+
+static FIL pack_index_file;
+static bool pack_index_open = false;
+
+//cluster link map for fast seek in the pack
+static DWORD pack_clmt[64];
+
+static char pack_line[SOKOBAN_PACK_LINE_LEN];
+
+static sokoban_pack_stats_t pack_stats;
+
+//maps xsb character to SOKOBAN_MAP_* value, 0 for characters not allowed in board line
+static char pack_map_char(char c){
+	switch(c){
+	case '#':
+		return SOKOBAN_MAP_WALL;
+	case '@':
+		return SOKOBAN_MAP_PLAYER;
+	case '+':
+		return SOKOBAN_MAP_PLAYER_ON_TARGET;
+	case '$':
+		return SOKOBAN_MAP_STONE;
+	case '*':
+		return SOKOBAN_MAP_STONE_ON_TARGET;
+	case '.':
+		return SOKOBAN_MAP_TARGET;
+	case ' ':
+	case '-':
+	case '_':
+		return SOKOBAN_MAP_EMPTY;
+	}
+
+	return 0;
+}
+
+static bool pack_is_board_line(const char *line){
+	bool has_wall = false;
+
+	for(; *line; line++){
+		if(!pack_map_char(*line)){
+			return false;
+		}
+		has_wall |= (*line == '#');
+	}
+
+	return has_wall;
+}
+
+//moves level parsed into top left corner to the center of the board
+static void pack_center_level(char *data_level, uint32_t width, uint32_t height){
+	uint32_t off_x = (BOARD_HEIGHT - height) / 2;
+	uint32_t off_y = (BOARD_WIDTH - width) / 2;
+
+	for(int x = height - 1; x >= 0; x--){
+		memmove(&data_level[(x + off_x) * BOARD_WIDTH + off_y], &data_level[x * BOARD_WIDTH], width);
+		memset(&data_level[x * BOARD_WIDTH], SOKOBAN_MAP_EMPTY, (x < off_x) ? BOARD_WIDTH : off_y);
+	}
+}
+
+//parses next level from current file position, data_level can be NULL to only skip the level,
+//entry receives level offset and size, height is 0 when end of file was reached
+static FRESULT pack_read_level(char *data_level, pack_index_entry_t *entry){
+	bool fits = true;
+	bool continuation = false; //rest of a line longer than line buffer
+	uint32_t players = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	FSIZE_t line_offset = f_tell(&pack_file);
+
+	if(data_level){
+		memset(data_level, SOKOBAN_MAP_EMPTY, BOARD_CELLS);
+		data_level[BOARD_CELLS] = '\0';
+	}
+
+	entry->offset = line_offset;
+
+	while(f_gets(pack_line, sizeof(pack_line), &pack_file)){
+		uint32_t len = strlen(pack_line);
+		bool truncated = (pack_line[len - 1] != '\n') && !f_eof(&pack_file);
+		bool skip = continuation;
+
+		continuation = truncated;
+		if(skip){
+			line_offset = f_tell(&pack_file);
+			continue;
+		}
+
+		if(pack_line[len - 1] == '\n'){
+			pack_line[--len] = '\0';
+		}
+
+		if(len == 0 || !pack_is_board_line(pack_line)){
+			if(height){
+				break; //first line after the level
+			}
+			line_offset = f_tell(&pack_file);
+			continue;
+		}
+
+		if(height == 0){
+			entry->offset = line_offset;
+		}
+
+		if(truncated || len > BOARD_WIDTH || height >= BOARD_HEIGHT){
+			fits = false;
+		}else if(data_level){
+			char *row = &data_level[height * BOARD_WIDTH];
+			for(uint32_t i = 0; i < len; i++){
+				row[i] = pack_map_char(pack_line[i]);
+				players += (row[i] == SOKOBAN_MAP_PLAYER || row[i] == SOKOBAN_MAP_PLAYER_ON_TARGET);
+			}
+		}
+
+		if(len > width){
+			width = len;
+		}
+		height++;
+	}
+
+	//sizes not fitting the board are saturated, they are rejected anyway
+	entry->width = (!fits || width > BOARD_WIDTH) ? 0xFF : width;
+	entry->height = (!fits || height > BOARD_HEIGHT) ? 0xFF : height;
+	entry->reserved = 0;
+
+	if(f_error(&pack_file)){
+		return FR_DISK_ERR;
+	}
+
+	if(data_level && height){
+		if(!fits || players != 1){
+			return FR_INVALID_PARAMETER;
+		}
+
+		pack_center_level(data_level, width, height);
+	}
+
+	return FR_OK;
+}
+
+static void pack_index_path(const char *path, char *index_path, uint32_t len){
+	index_path[0] = '\0';
+	strncat(index_path, path, len - sizeof(PACK_INDEX_SUFFIX));
+	strcat(index_path, PACK_INDEX_SUFFIX);
+}
+
+static bool pack_index_valid(const pack_index_header_t *header, const FILINFO *info){
+	return header->magic == PACK_INDEX_MAGIC && header->version == PACK_INDEX_VERSION &&
+		header->pack_size == info->fsize && header->pack_mtime == (((uint32_t)info->fdate << 16) | info->ftime) &&
+		header->level_num > 0;
+}
+
+//opens existing index of the pack, returns false when it's missing or outdated
+static bool pack_index_load(const char *index_path, const FILINFO *info){
+	pack_index_header_t header;
+	UINT read;
+
+	if(f_open(&pack_index_file, index_path, FA_READ) != FR_OK){
+		return false;
+	}
+
+	if(f_read(&pack_index_file, &header, sizeof(header), &read) != FR_OK || read != sizeof(header) ||
+		!pack_index_valid(&header, info) ||
+		f_size(&pack_index_file) != sizeof(header) + header.level_num * sizeof(pack_index_entry_t)){
+		f_close(&pack_index_file);
+		return false;
+	}
+
+	pack_level_num = header.level_num;
+
+	return true;
+}
+
+//scans whole pack writing offset of every level, the header is written last so an interrupted
+//build leaves an invalid index; without writable card the levels are only counted
+static FRESULT pack_index_build(const char *index_path, const FILINFO *info){
+	pack_index_header_t header = {0};
+	pack_index_entry_t entry;
+	UINT written;
+	FRESULT res;
+
+	uint32_t start = dwt_cycles();
+
+	bool writable = (f_open(&pack_index_file, index_path, FA_CREATE_ALWAYS | FA_WRITE | FA_READ) == FR_OK);
+	if(writable){
+		writable = (f_write(&pack_index_file, &header, sizeof(header), &written) == FR_OK && written == sizeof(header));
+	}
+
+	pack_level_num = 0;
+	while((res = pack_read_level(NULL, &entry)) == FR_OK && entry.height){
+		pack_level_num++;
+
+		if(writable){
+			writable = (f_write(&pack_index_file, &entry, sizeof(entry), &written) == FR_OK && written == sizeof(entry));
+		}
+	}
+
+	if(writable && res == FR_OK && pack_level_num){
+		header.magic = PACK_INDEX_MAGIC;
+		header.version = PACK_INDEX_VERSION;
+		header.pack_size = info->fsize;
+		header.pack_mtime = ((uint32_t)info->fdate << 16) | info->ftime;
+		header.level_num = pack_level_num;
+
+		writable = (f_lseek(&pack_index_file, 0) == FR_OK &&
+			f_write(&pack_index_file, &header, sizeof(header), &written) == FR_OK && written == sizeof(header) &&
+			f_sync(&pack_index_file) == FR_OK);
+	}else{
+		writable = false;
+	}
+
+	pack_stats.index_build_us = dwt_cycles_to_us(dwt_cycles() - start);
+	pack_stats.index_rebuilt = true;
+
+	if(!writable){
+		f_close(&pack_index_file);
+		f_unlink(index_path);
+	}
+	pack_index_open = writable;
+
+	return res;
+}
+
+FRESULT sokoban_pack_open(const char *path){
+	char index_path[64];
+	FILINFO info;
+
+	if(pack_open){
+		f_close(&pack_file);
+		pack_open = false;
+	}
+	if(pack_index_open){
+		f_close(&pack_index_file);
+		pack_index_open = false;
+	}
+
+	FRESULT res = f_stat(path, &info);
+	if(res != FR_OK){
+		return res;
+	}
+
+	res = f_open(&pack_file, path, FA_READ);
+	if(res != FR_OK){
+		return res;
+	}
+
+	//fast seek keeps level seeks from walking the FAT chain
+	pack_file.cltbl = pack_clmt;
+	pack_clmt[0] = sizeof(pack_clmt) / sizeof(DWORD);
+	if(f_lseek(&pack_file, CREATE_LINKMAP) != FR_OK){
+		pack_file.cltbl = NULL; //too fragmented, use normal seek
+	}
+
+	memset(&pack_stats, 0, sizeof(pack_stats));
+	pack_index_path(path, index_path, sizeof(index_path));
+
+	pack_index_open = pack_index_load(index_path, &info);
+	if(!pack_index_open){
+		res = pack_index_build(index_path, &info);
+	}
+
+	if(res != FR_OK || pack_level_num == 0){
+		f_close(&pack_file);
+		if(pack_index_open){
+			f_close(&pack_index_file);
+			pack_index_open = false;
+		}
+		return res != FR_OK ? res : FR_NO_FILE;
+	}
+
+	pack_stats.index_levels = pack_level_num;
+	pack_open = true;
+
+	return FR_OK;
+}
+
+bool sokoban_pack_is_open(void){
+	return pack_open;
+}
+
+uint32_t sokoban_pack_level_num(void){
+	return pack_level_num;
+}
+
+//finds level offset in the index, or by skipping preceding levels when there is no index
+static FRESULT pack_seek_level(uint32_t level){
+	pack_index_entry_t entry;
+	UINT read;
+	FRESULT res;
+
+	if(pack_index_open){
+		res = f_lseek(&pack_index_file, sizeof(pack_index_header_t) + level * sizeof(entry));
+		if(res == FR_OK){
+			res = f_read(&pack_index_file, &entry, sizeof(entry), &read);
+		}
+		if(res != FR_OK || read != sizeof(entry)){
+			return res != FR_OK ? res : FR_INT_ERR;
+		}
+
+		if(entry.width > BOARD_WIDTH || entry.height > BOARD_HEIGHT){
+			return FR_INVALID_PARAMETER;
+		}
+
+		return f_lseek(&pack_file, entry.offset);
+	}
+
+	res = f_lseek(&pack_file, 0);
+	for(uint32_t i = 0; res == FR_OK && i < level; i++){
+		res = pack_read_level(NULL, &entry);
+	}
+
+	return res;
+}
+
+FRESULT sokoban_pack_load_level(uint32_t level, char *data_level){
+	pack_index_entry_t entry;
+
+	if(!pack_open || level >= pack_level_num){
+		return FR_INVALID_PARAMETER;
+	}
+
+	uint32_t start = dwt_cycles();
+
+	FRESULT res = pack_seek_level(level);
+	if(res == FR_OK){
+		res = pack_read_level(data_level, &entry);
+	}
+
+	uint32_t elapsed = dwt_cycles_to_us(dwt_cycles() - start);
+	TRACE3("pack level %lu loaded in %lu us, result %lu", level, elapsed, res);
+	pack_stats.last_load_us = elapsed;
+	if(elapsed > pack_stats.max_load_us){
+		pack_stats.max_load_us = elapsed;
+	}
+
+	return res;
+}
+
+const sokoban_pack_stats_t *sokoban_pack_get_stats(void){
+	return &pack_stats;
+}
@@ -0,0 +1,732 @@
+#include <sokoban_solver.h>
+#include <string.h>
+
+#define ROW_MASK                         ((1u << BOARD_WIDTH) - 1)
+#define DISTANCE_NONE                    255
+#define MATCH_NO_PATH                    1024 //cost of stone which can't reach the target, such matching is a deadlock
+#define MATCH_INF                        (INT32_MAX / 2)
+#define EVICT_BUCKETS                    256  //histogram size when choosing nodes to forget
+
+static bool is_inside(sokoban_point_t pt){
+	return pt.x < BOARD_HEIGHT && pt.y < BOARD_WIDTH; //negative coordinates wrap around
+}
+
+static sokoban_point_t idx_to_point(uint32_t idx){
+	return (sokoban_point_t){idx / BOARD_WIDTH, idx % BOARD_WIDTH};
+}
+
+static uint32_t point_to_idx(sokoban_point_t pt){
+	return pt.x * BOARD_WIDTH + pt.y;
+}
+
+void sokoban_solver_init(sokoban_solver_t *solver, void *memory, uint32_t size){
+	solver->memory = memory;
+	solver->memory_size = size;
+	solver->tables_ready = false;
+}
+
+//splits memory for nodes with keys of stone_num stones, the index is kept at most 3/4 full
+//so probes stay short, which is 4/3 of a slot per node
+static void layout(sokoban_solver_t *solver){
+	solver->key_size = ((solver->stone_num + 1) * SOKOBAN_SOLVER_CELL_BITS + 7) / 8;
+	solver->node_size = (sizeof(sokoban_solver_node_t) + solver->key_size + 3) & ~3u;
+
+	const uint32_t node_bytes = solver->node_size + sizeof(uint32_t); //node and its open list entry
+	uint32_t capacity = (uint64_t)(solver->memory_size - sizeof(uint32_t)) * 3 / (node_bytes * 3 + 4 * sizeof(uint32_t));
+
+	solver->slot_num = capacity + capacity / 3 + 1;
+	solver->slots = (uint32_t *)solver->memory;
+	solver->open = solver->slots + solver->slot_num;
+	solver->nodes = (uint8_t *)(solver->open + capacity);
+	solver->capacity = capacity;
+	solver->node_num = 0;
+	solver->free_node = SOKOBAN_SOLVER_NONE;
+	memset(solver->slots, 0, solver->slot_num * sizeof(uint32_t));
+
+	solver->stats.capacity = capacity;
+	solver->stats.memory = solver->slot_num * sizeof(uint32_t) + capacity * node_bytes;
+	solver->stats.node_bytes = (solver->stats.memory + capacity / 2) / capacity;
+}
+
+static sokoban_solver_node_t *get_node(const sokoban_solver_t *solver, uint32_t idx){
+	return (sokoban_solver_node_t *)(solver->nodes + idx * solver->node_size);
+}
+
+//floods area reachable by the player, stones and walls block it
+static void reach_area(const uint32_t *blocked, sokoban_point_t player, uint32_t *reach){
+	memset(reach, 0, sizeof(sokoban_bitset_t));
+	sokoban_bitset_set(reach, player);
+
+	bool changed = true;
+	while(changed){
+		changed = false;
+		for(int row = 0; row < BOARD_HEIGHT; row++){
+			uint32_t free = ~blocked[row] & ROW_MASK;
+			uint32_t r = reach[row];
+			uint32_t n = r | (row > 0 ? reach[row - 1] : 0) | (row < BOARD_HEIGHT - 1 ? reach[row + 1] : 0);
+			n &= free;
+			for(uint32_t spread = (n << 1 | n >> 1) & free & ~n; spread; spread = (n << 1 | n >> 1) & free & ~n){
+				n |= spread; //along the row
+			}
+			if(n != r){
+				reach[row] = n;
+				changed = true;
+			}
+		}
+	}
+}
+
+static uint32_t first_cell(const uint32_t *set){
+	for(int row = 0; row < BOARD_HEIGHT; row++){
+		if(set[row]){
+			return row * BOARD_WIDTH + __builtin_ctz(set[row]);
+		}
+	}
+	return 0;
+}
+
+//pulls a stone back from target, the number of pulls is the number of pushes the other way;
+//a pull needs free cells for the player next to the stone and one further
+static void compute_push_distance(sokoban_solver_t *solver, uint32_t target, uint8_t *distance){
+	static uint16_t queue[BOARD_CELLS];
+	uint32_t head = 0, tail = 0;
+
+	memset(distance, DISTANCE_NONE, BOARD_CELLS);
+	distance[target] = 0;
+	queue[tail++] = target;
+
+	while(head < tail){
+		uint32_t idx = queue[head++];
+		sokoban_point_t pt = idx_to_point(idx);
+		for(sokoban_dir_t dir = SOKOBAN_DIR_UP; dir <= SOKOBAN_DIR_RIGHT; dir++){
+			sokoban_point_t to = {pt.x + sokoban_dir_delta[dir][0], pt.y + sokoban_dir_delta[dir][1]};
+			sokoban_point_t player = {to.x + sokoban_dir_delta[dir][0], to.y + sokoban_dir_delta[dir][1]};
+			if(!is_inside(to) || !is_inside(player) || sokoban_bitset_test(solver->board.wall, to) ||
+				sokoban_bitset_test(solver->board.wall, player)){
+				continue;
+			}
+
+			uint32_t to_idx = point_to_idx(to);
+			if(distance[to_idx] == DISTANCE_NONE && distance[idx] < DISTANCE_NONE - 1){
+				distance[to_idx] = distance[idx] + 1;
+				queue[tail++] = to_idx;
+			}
+		}
+	}
+}
+
+//distance tables depend only on walls and targets, they are reused while the level stays the same
+static void compute_tables(sokoban_solver_t *solver){
+	if(!solver->tables_ready || memcmp(solver->table_wall, solver->board.wall, sizeof(sokoban_bitset_t)) ||
+		memcmp(solver->table_target, solver->board.target, sizeof(sokoban_bitset_t))){
+		solver->target_num = 0;
+		for(uint32_t idx = 0; idx < BOARD_CELLS && solver->target_num < SOKOBAN_SOLVER_MAX_STONES; idx++){
+			if(sokoban_bitset_test(solver->board.target, idx_to_point(idx))){
+				compute_push_distance(solver, idx, solver->push_distance[solver->target_num++]);
+			}
+		}
+
+		memcpy(solver->table_wall, solver->board.wall, sizeof(sokoban_bitset_t));
+		memcpy(solver->table_target, solver->board.target, sizeof(sokoban_bitset_t));
+		solver->tables_ready = true;
+		solver->stats.tables++;
+	}
+}
+
+static int32_t match_cost(const sokoban_solver_t *solver, const sokoban_matching_t *m, uint32_t row, uint32_t col){
+	uint8_t d = solver->push_distance[row - 1][m->cell[col - 1]];
+	return d == DISTANCE_NONE ? MATCH_NO_PATH : d;
+}
+
+//assigns free row along the shortest augmenting path, potentials stay feasible
+static void match_augment(const sokoban_solver_t *solver, sokoban_matching_t *m, uint32_t row){
+	int32_t min_slack[SOKOBAN_SOLVER_MAX_STONES + 1];
+	uint8_t way[SOKOBAN_SOLVER_MAX_STONES + 1];
+	bool used[SOKOBAN_SOLVER_MAX_STONES + 1];
+	uint32_t cols = solver->stone_num;
+
+	for(uint32_t j = 0; j <= cols; j++){
+		min_slack[j] = MATCH_INF;
+		used[j] = false;
+	}
+
+	m->row[0] = row;
+	uint32_t j0 = 0;
+	do{
+		used[j0] = true;
+		uint32_t i0 = m->row[j0], j1 = 0;
+		int32_t delta = MATCH_INF;
+
+		for(uint32_t j = 1; j <= cols; j++){
+			if(!used[j]){
+				int32_t slack = match_cost(solver, m, i0, j) - m->u[i0] - m->v[j];
+				if(slack < min_slack[j]){
+					min_slack[j] = slack;
+					way[j] = j0;
+				}
+				if(min_slack[j] < delta){
+					delta = min_slack[j];
+					j1 = j;
+				}
+			}
+		}
+
+		for(uint32_t j = 0; j <= cols; j++){
+			if(used[j]){
+				m->u[m->row[j]] += delta;
+				m->v[j] -= delta;
+			}else{
+				min_slack[j] -= delta;
+			}
+		}
+		j0 = j1;
+	}while(m->row[j0] != 0);
+
+	do{ //flip the path
+		uint32_t j1 = way[j0];
+		m->row[j0] = m->row[j1];
+		j0 = j1;
+	}while(j0);
+}
+
+static uint32_t match_total(const sokoban_solver_t *solver, const sokoban_matching_t *m){
+	uint32_t total = 0;
+	for(uint32_t j = 1; j <= solver->stone_num; j++){
+		if(m->row[j]){
+			total += match_cost(solver, m, m->row[j], j);
+		}
+	}
+
+	return total >= MATCH_NO_PATH ? DISTANCE_NONE : (total < DISTANCE_NONE ? total : DISTANCE_NONE - 1);
+}
+
+//lower bound of pushes left for stones in cells of m, DISTANCE_NONE when a target can't get a stone
+static uint32_t match_solve(sokoban_solver_t *solver, sokoban_matching_t *m){
+	memset(m->u, 0, sizeof(m->u));
+	memset(m->v, 0, sizeof(m->v));
+	memset(m->row, 0, sizeof(m->row));
+	for(uint32_t i = 1; i <= solver->target_num; i++){
+		match_augment(solver, m, i);
+	}
+
+	solver->stats.matchings++;
+	return match_total(solver, m);
+}
+
+//repairs matching after stone in column col has moved, O(n^2) instead of O(n^3) of match_solve();
+//with more stones than targets a free column would need zero potential, it's solved again instead
+static uint32_t match_repair(sokoban_solver_t *solver, sokoban_matching_t *m, uint32_t col){
+	if(solver->stone_num != solver->target_num){
+		return match_solve(solver, m);
+	}
+
+	uint32_t row = m->row[col];
+	m->row[col] = 0;
+
+	int32_t v = MATCH_INF;
+	for(uint32_t i = 1; i <= solver->target_num; i++){ //tightest potential keeping the column feasible
+		int32_t slack = match_cost(solver, m, i, col) - m->u[i];
+		if(slack < v){
+			v = slack;
+		}
+	}
+	m->v[col] = v;
+	match_augment(solver, m, row);
+
+	solver->stats.repairs++;
+	return match_total(solver, m);
+}
+
+//stone cells in row-major order, the same order expand() walks stones in
+static void match_cells(sokoban_solver_t *solver, sokoban_matching_t *m, const uint32_t *stone){
+	uint32_t n = 0;
+	for(int row = 0; row < BOARD_HEIGHT; row++){
+		for(uint32_t bits = stone[row]; bits; bits &= bits - 1){
+			if(n < SOKOBAN_SOLVER_MAX_STONES){
+				m->cell[n] = row * BOARD_WIDTH + __builtin_ctz(bits);
+			}
+			n++;
+		}
+	}
+	solver->stone_num = n;
+}
+
+static uint32_t node_f(const sokoban_solver_node_t *node){
+	return node->g + node->h;
+}
+
+static bool node_less(const sokoban_solver_t *solver, uint32_t a, uint32_t b){
+	const sokoban_solver_node_t *na = get_node(solver, a);
+	const sokoban_solver_node_t *nb = get_node(solver, b);
+	uint32_t fa = node_f(na);
+	uint32_t fb = node_f(nb);
+
+	return fa < fb || (fa == fb && na->g > nb->g); //deeper nodes first on ties
+}
+
+static void open_sift_down(sokoban_solver_t *solver, uint32_t i, uint32_t node){
+	for(;;){
+		uint32_t child = i * 2 + 1;
+		if(child >= solver->open_num){
+			break;
+		}
+		if(child + 1 < solver->open_num && node_less(solver, solver->open[child + 1], solver->open[child])){
+			child++;
+		}
+		if(!node_less(solver, solver->open[child], node)){
+			break;
+		}
+		solver->open[i] = solver->open[child];
+		i = child;
+	}
+	solver->open[i] = node;
+}
+
+static void open_push(sokoban_solver_t *solver, uint32_t node){
+	uint32_t i = solver->open_num++;
+	while(i > 0){
+		uint32_t parent = (i - 1) / 2;
+		if(!node_less(solver, node, solver->open[parent])){
+			break;
+		}
+		solver->open[i] = solver->open[parent];
+		i = parent;
+	}
+	solver->open[i] = node;
+
+	if(solver->open_num > solver->stats.max_open){
+		solver->stats.max_open = solver->open_num;
+	}
+}
+
+static uint32_t open_pop(sokoban_solver_t *solver){
+	uint32_t top = solver->open[0];
+	uint32_t last = solver->open[--solver->open_num];
+
+	if(solver->open_num){
+		open_sift_down(solver, 0, last);
+	}
+	return top;
+}
+
+static void key_put(uint8_t *key, uint32_t *bit, uint32_t cell){
+	uint32_t bits = cell << (*bit & 7);
+	key[*bit >> 3] |= bits;
+	key[(*bit >> 3) + 1] |= bits >> 8;
+	*bit += SOKOBAN_SOLVER_CELL_BITS;
+}
+
+//packs stones of cells into solver->key, the one at index moved replaced by cell so they stay
+//sorted (moved is SOKOBAN_SOLVER_NONE when none is), followed by the player
+static void key_pack(sokoban_solver_t *solver, const uint16_t *cells, uint32_t moved, uint32_t cell, uint32_t player){
+	uint8_t *key = solver->key;
+	uint32_t bit = 0;
+	bool placed = moved == SOKOBAN_SOLVER_NONE;
+
+	memset(key, 0, solver->key_size + 1);
+	for(uint32_t i = 0; i < solver->stone_num; i++){
+		if(i == moved){
+			continue;
+		}
+		if(!placed && cells[i] > cell){
+			key_put(key, &bit, cell);
+			placed = true;
+		}
+		key_put(key, &bit, cells[i]);
+	}
+	if(!placed){
+		key_put(key, &bit, cell);
+	}
+	key_put(key, &bit, player);
+}
+
+//unpacks stone cells of key and returns the player cell
+static uint32_t key_unpack(const sokoban_solver_t *solver, const uint8_t *key, uint16_t *cells){
+	uint32_t bit = 0, cell = 0;
+
+	for(uint32_t i = 0; i <= solver->stone_num; i++, bit += SOKOBAN_SOLVER_CELL_BITS){
+		uint32_t byte = bit >> 3;
+		uint32_t bits = key[byte] | (byte + 1 < solver->key_size ? key[byte + 1] << 8 : 0);
+		cell = bits >> (bit & 7) & ((1u << SOKOBAN_SOLVER_CELL_BITS) - 1);
+		if(i < solver->stone_num){
+			cells[i] = cell;
+		}
+	}
+	return cell;
+}
+
+static uint32_t stone_hash(const sokoban_solver_t *solver, const uint16_t *cells){
+	uint32_t hash = 0;
+	for(uint32_t i = 0; i < solver->stone_num; i++){
+		hash ^= (uint32_t)sokoban_zobrist_stone[cells[i]];
+	}
+	return hash;
+}
+
+static uint32_t node_hash(const sokoban_solver_t *solver, uint32_t idx){
+	uint16_t cells[SOKOBAN_SOLVER_MAX_STONES];
+	uint32_t player = key_unpack(solver, get_node(solver, idx)->key, cells);
+	return stone_hash(solver, cells) ^ (uint32_t)sokoban_zobrist_player[player];
+}
+
+static uint32_t slot_home(const sokoban_solver_t *solver, uint32_t hash){
+	return (uint64_t)hash * solver->slot_num >> 32;
+}
+
+static uint32_t slot_next(const sokoban_solver_t *solver, uint32_t i){
+	return i + 1 < solver->slot_num ? i + 1 : 0;
+}
+
+//returns slot holding the state packed in solver->key or the empty slot where it belongs
+static uint32_t *find_slot(sokoban_solver_t *solver, uint32_t hash){
+	for(uint32_t i = slot_home(solver, hash);; i = slot_next(solver, i)){
+		uint32_t *slot = &solver->slots[i];
+		if(*slot == 0 || !memcmp(get_node(solver, *slot - 1)->key, solver->key, solver->key_size)){
+			return slot;
+		}
+	}
+}
+
+//removes node from the index, following entries of the probe run are shifted back into the hole
+static void remove_slot(sokoban_solver_t *solver, uint32_t idx){
+	uint32_t i = slot_home(solver, node_hash(solver, idx));
+	while(solver->slots[i] != idx + 1){
+		i = slot_next(solver, i);
+	}
+
+	for(uint32_t j = slot_next(solver, i); solver->slots[j] != 0; j = slot_next(solver, j)){
+		uint32_t home = slot_home(solver, node_hash(solver, solver->slots[j] - 1));
+		bool stays = i <= j ? home > i && home <= j : home > i || home <= j; //home cyclically in (i, j]
+		if(!stays){
+			solver->slots[i] = solver->slots[j];
+			i = j;
+		}
+	}
+	solver->slots[i] = 0;
+}
+
+static bool is_leaf(const sokoban_solver_node_t *node){
+	return !(node->flags & (SOKOBAN_SOLVER_NODE_CLOSED | SOKOBAN_SOLVER_NODE_EXPANDED | SOKOBAN_SOLVER_NODE_FREE));
+}
+
+static uint32_t bucket_of(uint32_t value){
+	return value < EVICT_BUCKETS ? value : EVICT_BUCKETS - 1;
+}
+
+//table is full: forgets up to a quarter of unexpanded nodes, whole buckets of the highest g + h
+//and the shallow ones of the bucket below them, as ties are expanded deepest first; their parents
+//are reopened with the smallest g + h forgotten below them, so the search comes back there when
+//everything cheaper is done; only the deepest nodes of the lowest g + h, which are the next to
+//expand, always stay; returns false when nothing could be freed
+static bool evict(sokoban_solver_t *solver){
+	uint32_t count[EVICT_BUCKETS] = {0};
+	uint32_t f_min = UINT32_MAX, leaves = 0;
+
+	for(uint32_t idx = 0; idx < solver->node_num; idx++){
+		const sokoban_solver_node_t *node = get_node(solver, idx);
+		if(!(node->flags & (SOKOBAN_SOLVER_NODE_CLOSED | SOKOBAN_SOLVER_NODE_FREE)) && node_f(node) < f_min){
+			f_min = node_f(node);
+		}
+	}
+	for(uint32_t idx = 0; idx < solver->node_num; idx++){
+		const sokoban_solver_node_t *node = get_node(solver, idx);
+		if(is_leaf(node)){
+			count[bucket_of(node_f(node) - f_min)]++;
+			leaves++;
+		}
+	}
+
+	uint32_t target = leaves / 4, limit = EVICT_BUCKETS, num = 0;
+	while(limit > 1 && num + count[limit - 1] <= target){
+		num += count[--limit];
+	}
+
+	//nodes of bucket limit - 1 with fewer pushes are forgotten too, at least one level of them
+	//when nothing else is; the lowest bucket keeps its deepest level
+	uint32_t depth = 0;
+	if(num < target || num == 0){
+		uint32_t deepest = 0;
+		memset(count, 0, sizeof(count));
+		for(uint32_t idx = 0; idx < solver->node_num; idx++){
+			const sokoban_solver_node_t *node = get_node(solver, idx);
+			if(is_leaf(node) && bucket_of(node_f(node) - f_min) == limit - 1){
+				uint32_t level = bucket_of(node->g);
+				count[level]++;
+				if(level > deepest){
+					deepest = level;
+				}
+			}
+		}
+		while(depth < EVICT_BUCKETS && (num + count[depth] <= target || num == 0) && !(limit == 1 && depth == deepest)){
+			num += count[depth++];
+		}
+	}
+
+	for(uint32_t idx = 0; idx < solver->node_num && num; idx++){
+		sokoban_solver_node_t *node = get_node(solver, idx);
+		uint32_t bucket = bucket_of(node_f(node) - f_min);
+		if(!is_leaf(node) || bucket < limit - 1 || (bucket == limit - 1 && bucket_of(node->g) >= depth)){
+			continue;
+		}
+
+		remove_slot(solver, idx);
+
+		sokoban_solver_node_t *parent = get_node(solver, node->parent);
+		uint32_t h = node_f(node) - parent->g;
+		if(h > DISTANCE_NONE - 1){
+			h = DISTANCE_NONE - 1;
+		}
+		if(parent->flags & SOKOBAN_SOLVER_NODE_CLOSED){
+			parent->flags &= ~SOKOBAN_SOLVER_NODE_CLOSED;
+			parent->h = h;
+		}else if(h < parent->h){
+			parent->h = h;
+		}
+
+		node->flags = SOKOBAN_SOLVER_NODE_FREE;
+		node->parent = solver->free_node;
+		solver->free_node = idx;
+		solver->stats.nodes--;
+		solver->stats.evicted++;
+	}
+
+	//open list is built again, this drops its stale entries too
+	solver->open_num = 0;
+	for(uint32_t idx = 0; idx < solver->node_num; idx++){
+		if(!(get_node(solver, idx)->flags & (SOKOBAN_SOLVER_NODE_CLOSED | SOKOBAN_SOLVER_NODE_FREE))){
+			solver->open[solver->open_num++] = idx;
+		}
+	}
+	for(uint32_t i = solver->open_num / 2; i-- > 0;){
+		open_sift_down(solver, i, solver->open[i]);
+	}
+
+	solver->stats.evictions++;
+	return solver->stats.nodes < solver->capacity && solver->open_num < solver->capacity;
+}
+
+//adds state packed in solver->key, reached by a push from parent, or updates it when it was
+//found with more pushes; returns false when the table is full and nothing can be forgotten
+static bool add_node(sokoban_solver_t *solver, uint32_t hash, uint32_t parent, uint32_t g, uint32_t h){
+	if((solver->stats.nodes == solver->capacity || solver->open_num == solver->capacity) && !evict(solver)){
+		return false;
+	}
+
+	uint32_t *slot = find_slot(solver, hash);
+	solver->stats.generated++;
+
+	if(*slot != 0){
+		solver->stats.duplicates++;
+		sokoban_solver_node_t *node = get_node(solver, *slot - 1);
+		if(!(node->flags & SOKOBAN_SOLVER_NODE_CLOSED) && g < node->g){ //old heap entry is skipped once the node is closed
+			node->g = g;
+			node->parent = parent;
+			open_push(solver, *slot - 1);
+		}
+		return true;
+	}
+
+	uint32_t idx = solver->free_node;
+	if(idx != SOKOBAN_SOLVER_NONE){
+		solver->free_node = get_node(solver, idx)->parent;
+	}else{
+		idx = solver->node_num++;
+	}
+	solver->stats.nodes++;
+
+	sokoban_solver_node_t *node = get_node(solver, idx);
+	memcpy(node->key, solver->key, solver->key_size);
+	node->parent = parent;
+	node->g = g;
+	node->h = h;
+	node->flags = 0;
+	*slot = idx + 1;
+
+	open_push(solver, idx);
+	return true;
+}
+
+static bool is_goal(const sokoban_solver_t *solver, const uint32_t *stone){
+	for(int row = 0; row < BOARD_HEIGHT; row++){
+		if(solver->board.target[row] & ~stone[row]){
+			return false;
+		}
+	}
+	return true;
+}
+
+//push leading from parent to node, stones present in only one of them are the moved one
+static uint16_t find_push(const sokoban_solver_t *solver, uint32_t parent, uint32_t node){
+	uint16_t before[SOKOBAN_SOLVER_MAX_STONES], after[SOKOBAN_SOLVER_MAX_STONES];
+	key_unpack(solver, get_node(solver, parent)->key, before);
+	key_unpack(solver, get_node(solver, node)->key, after);
+
+	uint32_t from = 0, to = 0;
+	for(uint32_t i = 0, j = 0; i < solver->stone_num || j < solver->stone_num;){
+		if(j == solver->stone_num || (i < solver->stone_num && before[i] < after[j])){
+			from = before[i++];
+		}else if(i == solver->stone_num || after[j] < before[i]){
+			to = after[j++];
+		}else{
+			i++;
+			j++;
+		}
+	}
+
+	sokoban_point_t a = idx_to_point(from), b = idx_to_point(to);
+	return SOKOBAN_PUSH(from, sokoban_delta_to_dir(b.x - a.x, b.y - a.y));
+}
+
+//stores pushes on the path from the start to node
+static void store_solution(const sokoban_solver_t *solver, uint32_t node, uint16_t *pushes, uint32_t max_pushes, uint32_t *push_num){
+	*push_num = get_node(solver, node)->g;
+
+	for(uint32_t i = *push_num; get_node(solver, node)->parent != SOKOBAN_SOLVER_NONE; node = get_node(solver, node)->parent){
+		if(--i < max_pushes){
+			pushes[i] = find_push(solver, get_node(solver, node)->parent, node);
+		}
+	}
+}
+
+//unpacks node into matching cells and board stones, returns the player cell
+static uint32_t load_node(sokoban_solver_t *solver, uint32_t idx){
+	uint32_t player = key_unpack(solver, get_node(solver, idx)->key, solver->matching.cell);
+
+	memset(solver->board.stone, 0, sizeof(sokoban_bitset_t));
+	for(uint32_t i = 0; i < solver->stone_num; i++){
+		sokoban_bitset_set(solver->board.stone, idx_to_point(solver->matching.cell[i]));
+	}
+	return player;
+}
+
+//creates children of node loaded by load_node() for every stone the player can push
+static bool expand(sokoban_solver_t *solver, uint32_t idx, uint32_t node_player){
+	const sokoban_solver_node_t *node = get_node(solver, idx);
+	sokoban_bitset_t blocked, reach, child_blocked, child_reach;
+	uint32_t *stone = solver->board.stone;
+	uint16_t *cells = solver->matching.cell;
+
+	for(int row = 0; row < BOARD_HEIGHT; row++){
+		blocked[row] = solver->board.wall[row] | stone[row];
+	}
+	reach_area(blocked, idx_to_point(node_player), reach);
+
+	match_solve(solver, &solver->matching);
+
+	uint32_t g = node->g + 1;
+	uint32_t hash = stone_hash(solver, cells);
+
+	for(uint32_t col = 1; col <= solver->stone_num; col++){ //matching column of this stone
+		uint32_t from_idx = cells[col - 1];
+		sokoban_point_t from = idx_to_point(from_idx);
+
+		for(sokoban_dir_t dir = SOKOBAN_DIR_UP; dir <= SOKOBAN_DIR_RIGHT; dir++){
+			int32_t delta_x = sokoban_dir_delta[dir][0];
+			int32_t delta_y = sokoban_dir_delta[dir][1];
+			sokoban_point_t stand = {from.x - delta_x, from.y - delta_y};
+			sokoban_point_t to = {from.x + delta_x, from.y + delta_y};
+
+			if(!is_inside(stand) || !is_inside(to) || !sokoban_bitset_test(reach, stand) || sokoban_bitset_test(blocked, to)){
+				continue;
+			}
+
+			uint32_t to_idx = point_to_idx(to);
+			if(sokoban_bitset_test(solver->board.dead, to)){
+				solver->stats.deadlocks++; //no target can be reached from there
+				continue;
+			}
+
+			sokoban_bitset_clear(stone, from);
+			sokoban_bitset_set(stone, to);
+			if(sokoban_board_stone_deadlocked(&solver->board, to)){
+				solver->stats.deadlocks++;
+				sokoban_bitset_clear(stone, to);
+				sokoban_bitset_set(stone, from);
+				continue;
+			}
+			memcpy(child_blocked, blocked, sizeof(blocked));
+			sokoban_bitset_clear(child_blocked, from);
+			sokoban_bitset_set(child_blocked, to);
+			reach_area(child_blocked, from, child_reach);
+
+			solver->child = solver->matching;
+			solver->child.cell[col - 1] = to_idx;
+			uint32_t child_h = match_repair(solver, &solver->child, col);
+			sokoban_bitset_clear(stone, to);
+			sokoban_bitset_set(stone, from);
+			if(child_h == DISTANCE_NONE){ //stones can't cover all targets at once
+				solver->stats.deadlocks++;
+				continue;
+			}
+
+			uint32_t player = first_cell(child_reach);
+			uint32_t child_hash = hash ^ (uint32_t)(sokoban_zobrist_stone[from_idx] ^ sokoban_zobrist_stone[to_idx] ^
+				sokoban_zobrist_player[player]);
+			key_pack(solver, cells, col - 1, to_idx, player);
+			if(!add_node(solver, child_hash, idx, g, child_h)){
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+sokoban_solver_result_t sokoban_solver_solve(sokoban_solver_t *solver, const sokoban_board_t *board,
+	uint16_t *pushes, uint32_t max_pushes, uint32_t *push_num, sokoban_solver_poll_t poll){
+	memset(&solver->stats, 0, sizeof(solver->stats));
+	solver->open_num = 0;
+	*push_num = 0;
+
+	solver->board = *board;
+	compute_tables(solver);
+
+	match_cells(solver, &solver->matching, board->stone);
+	if(solver->target_num > solver->stone_num || solver->stone_num > SOKOBAN_SOLVER_MAX_STONES){
+		return solver->stone_num > SOKOBAN_SOLVER_MAX_STONES ? SOKOBAN_SOLVER_OUT_OF_MEMORY : SOKOBAN_SOLVER_UNSOLVABLE;
+	}
+	layout(solver);
+
+	uint32_t h = match_solve(solver, &solver->matching);
+	if(h == DISTANCE_NONE || board->deadlocked){
+		return SOKOBAN_SOLVER_UNSOLVABLE;
+	}
+
+	sokoban_bitset_t blocked, reach;
+	for(int row = 0; row < BOARD_HEIGHT; row++){
+		blocked[row] = board->wall[row] | board->stone[row];
+	}
+	reach_area(blocked, board->player_pos, reach);
+
+	uint32_t start = first_cell(reach);
+	uint32_t player_idx = board->player_pos.x * BOARD_WIDTH + board->player_pos.y;
+	uint32_t hash = board->hash ^ sokoban_zobrist_player[player_idx] ^ sokoban_zobrist_player[start];
+	key_pack(solver, solver->matching.cell, SOKOBAN_SOLVER_NONE, 0, start);
+	add_node(solver, hash, SOKOBAN_SOLVER_NONE, 0, h);
+
+	while(solver->open_num){
+		uint32_t idx = open_pop(solver);
+		sokoban_solver_node_t *node = get_node(solver, idx);
+		if(node->flags & SOKOBAN_SOLVER_NODE_CLOSED){ //stale entry of node reached again with fewer pushes
+			continue;
+		}
+		node->flags |= SOKOBAN_SOLVER_NODE_CLOSED;
+
+		uint32_t player = load_node(solver, idx);
+		if(is_goal(solver, solver->board.stone)){
+			store_solution(solver, idx, pushes, max_pushes, push_num);
+			return SOKOBAN_SOLVER_SOLVED;
+		}
+
+		node->flags |= SOKOBAN_SOLVER_NODE_EXPANDED;
+		if(!expand(solver, idx, player)){
+			return SOKOBAN_SOLVER_OUT_OF_MEMORY;
+		}
+
+		if(++solver->stats.expanded % SOKOBAN_SOLVER_POLL_NODES == 0 && poll != NULL && !poll()){
+			return SOKOBAN_SOLVER_CANCELLED;
+		}
+	}
+
+	return SOKOBAN_SOLVER_UNSOLVABLE;
+}
@@ -38,6 +38,11 @@
 
 /* USER CODE BEGIN 0 */
 #include "term_io.h"
+#include "dma2d_queue.h"
+#include "lcd_frame.h"
+#include "input_queue.h"
+#include "uart_log.h"
+#include "touch.h"
 
 /* SAI handler declared in "stm32746g_discovery_audio.c" file */
 extern SAI_HandleTypeDef haudio_out_sai;
@@ -57,6 +62,10 @@ void HL_Default_Handler(void)
   */
 void DMA2_Stream7_IRQHandler(void)
 {
+  if (uart_log_dma_irq_handler())
+  {
+    return;
+  }
   HAL_DMA_IRQHandler(haudio_in_sai.hdmarx);
 }
 
@@ -69,6 +78,14 @@ void DMA2_Stream4_IRQHandler(void)
   HAL_DMA_IRQHandler(haudio_out_sai.hdmatx);
 }
 
+/**
+  * @brief This function handles USART1 global interrupt, received bytes go to the input queue.
+  */
+void USART1_IRQHandler(void)
+{
+  input_queue_uart_irq_handler();
+}
+
 
 /* USER CODE END 0 */
 
@@ -247,6 +264,7 @@ void TIM1_UP_TIM10_IRQHandler(void)
 void EXTI15_10_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI15_10_IRQn 0 */
+  touch_irq_handler(); /* line 11 may be pending at the same time, it's handled below */
 
   /* USER CODE END EXTI15_10_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_11);
@@ -345,7 +363,10 @@ void USART6_IRQHandler(void)
 void LTDC_IRQHandler(void)
 {
   /* USER CODE BEGIN LTDC_IRQn 0 */
-
+  if (lcd_frame_irq_handler())
+  {
+    return;
+  }
   /* USER CODE END LTDC_IRQn 0 */
   HAL_LTDC_IRQHandler(&hltdc);
   /* USER CODE BEGIN LTDC_IRQn 1 */
@@ -359,7 +380,10 @@ void LTDC_IRQHandler(void)
 void DMA2D_IRQHandler(void)
 {
   /* USER CODE BEGIN DMA2D_IRQn 0 */
-
+  if (dma2d_queue_irq_handler())
+  {
+    return;
+  }
   /* USER CODE END DMA2D_IRQn 0 */
   HAL_DMA2D_IRQHandler(&hdma2d);
   /* USER CODE BEGIN DMA2D_IRQn 1 */
@@ -4,6 +4,7 @@
 #include <stdarg.h>
 #include "term_io.h"
 #include "dbgu.h"
+#include "uart_log.h"
 #include "stm32f7xx_hal.h"
 
 
@@ -64,7 +65,7 @@ int xatoi (char **str, long *res)
 
 void xputc (char c)
 {
-	debug_chr(c);
+	uart_log_putc(c);
 }
 
 
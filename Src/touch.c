@@ -0,0 +1,121 @@
+#include <touch.h>
+#include <stdlib.h>
+
+#include "cmsis_os.h"
+#include "task.h"
+#include "stm32746g_discovery_lcd.h"
+#include "stm32746g_discovery_ts.h"
+#include "sokoban.h"
+#include "input_queue.h"
+#include "term_io.h"
+#include "dwt.h"
+#include "trace.h"
+
+static TaskHandle_t touch_task = NULL;
+static volatile touch_stats_t stats;
+
+//first and last point of touch in progress
+static uint16_t start_x, start_y, last_x, last_y;
+static uint32_t start_cycles;
+static TickType_t start_tick;
+
+bool touch_irq_handler(void){
+	if(!__HAL_GPIO_EXTI_GET_IT(TS_INT_PIN)){
+		return false;
+	}
+	__HAL_GPIO_EXTI_CLEAR_IT(TS_INT_PIN);
+	stats.interrupts++;
+
+	BaseType_t woken = pdFALSE;
+	if(touch_task != NULL){
+		vTaskNotifyGiveFromISR(touch_task, &woken);
+	}
+	portYIELD_FROM_ISR(woken);
+	return true;
+}
+
+//swipe directions are given on screen, keys are the ones which move player that way (see moveCursor())
+static uint8_t touch_swipe_key(int32_t dx, int32_t dy){
+	if(abs(dx) > abs(dy)){
+		return dx > 0 ? 'a' : 'd';
+	}
+	return dy > 0 ? 'w' : 's';
+}
+
+static void touch_end(void){
+	int32_t dx = (int32_t)last_x - start_x;
+	int32_t dy = (int32_t)last_y - start_y;
+	TRACE3("touch end dx %ld, dy %ld, start %lu", dx, dy, start_y * BSP_LCD_GetXSize() + start_x);
+
+	if(abs(dx) >= TOUCH_SWIPE_MIN_PX || abs(dy) >= TOUCH_SWIPE_MIN_PX){
+		stats.swipes++;
+		input_queue_post(INPUT_SOURCE_TOUCH, INPUT_KEY_PRESS, touch_swipe_key(dx, dy), 0, start_cycles);
+		return;
+	}
+
+	uint32_t row = start_y / CELL_SIZE;
+	uint32_t col = start_x / CELL_SIZE;
+	if(xTaskGetTickCount() - start_tick > pdMS_TO_TICKS(TOUCH_TAP_MAX_MS) || row >= BOARD_HEIGHT || col >= BOARD_WIDTH){
+		stats.ignored++;
+		return;
+	}
+
+	stats.taps++;
+	input_queue_post(INPUT_SOURCE_TOUCH, INPUT_KEY_PRESS, INPUT_KEY_CELL, row * BOARD_WIDTH + col, start_cycles);
+}
+
+//sleeps until the panel interrupts, touch in progress is ended by a report without contact
+//or by silence of the panel, whichever comes first
+static void touch_task_run(void const *argument){
+	touch_task = osThreadGetId(); //set before the interrupt is enabled
+	if(BSP_TS_Init(BSP_LCD_GetXSize(), BSP_LCD_GetYSize()) != TS_OK || BSP_TS_ITConfig() != TS_OK){
+		xprintf("Touch panel not found\n");
+		vTaskDelete(NULL);
+	}
+
+	bool touching = false;
+	for(;;){
+		uint32_t events = ulTaskNotifyTake(pdTRUE, touching ? pdMS_TO_TICKS(TOUCH_RELEASE_MS) : portMAX_DELAY);
+		uint32_t cycles = dwt_cycles();
+
+		TS_StateTypeDef state = {0};
+		if(events){
+			stats.reads++;
+			if(BSP_TS_GetState(&state) != TS_OK){
+				if(touching){ //don't turn a half-read touch into a move
+					stats.ignored++;
+					touching = false;
+				}
+				continue;
+			}
+		}
+
+		if(state.touchDetected == 0){
+			if(touching){
+				touching = false;
+				touch_end();
+			}
+			continue;
+		}
+
+		last_x = state.touchX[0];
+		last_y = state.touchY[0];
+		if(!touching){
+			touching = true;
+			stats.touches++;
+			start_x = last_x;
+			start_y = last_y;
+			start_cycles = cycles;
+			start_tick = xTaskGetTickCount();
+		}
+	}
+}
+
+void touch_start(void){
+	osThreadDef(touchTask, touch_task_run, osPriorityNormal, 0, 512);
+	osThreadCreate(osThread(touchTask), NULL);
+}
+
+const touch_stats_t *touch_get_stats(void){
+	return (const touch_stats_t *)&stats;
+}
@@ -0,0 +1,32 @@
+#include <trace.h>
+
+#include "term_io.h"
+#include "uart_log.h"
+
+trace_buffer_t trace_buffer;
+
+void trace_init(void){
+	trace_buffer.magic = TRACE_MAGIC;
+	trace_buffer.record_num = TRACE_BUFFER_LEN;
+	trace_buffer.head = 0;
+	trace_buffer.core_clock = SystemCoreClock;
+}
+
+//records are copied one by one, new ones may overwrite the oldest while dumping
+void trace_dump(void){
+	uart_log_policy_t policy = uart_log_get_policy();
+	uint32_t head = trace_buffer.head;
+	uint32_t first = head > TRACE_BUFFER_LEN ? head - TRACE_BUFFER_LEN : 0;
+
+	uart_log_set_policy(UART_LOG_BLOCK);
+
+	xprintf("trace header %08lX %08lX %08lX %08lX\n", trace_buffer.magic, trace_buffer.record_num, head, trace_buffer.core_clock);
+	for(uint32_t i = first; i < head; i++){
+		trace_record_t record = trace_buffer.records[i % TRACE_BUFFER_LEN];
+		xprintf("trace %08lX %08lX %08lX %08lX %08lX %08lX %08lX\n", i, record.cycles, record.tick, (uint32_t)record.fmt,
+			record.args[0], record.args[1], record.args[2]);
+	}
+	xprintf("trace end\n");
+
+	uart_log_set_policy(policy);
+}
@@ -0,0 +1,163 @@
+#include <uart_log.h>
+
+#include "dbgu.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#define UART_LOG_DMA                     DMA2_Stream7
+#define UART_LOG_DMA_CHANNEL             DMA_CHANNEL_4
+#define UART_LOG_DMA_IRQ                 DMA2_Stream7_IRQn
+#define UART_LOG_DMA_FLAGS               (DMA_HIFCR_CTCIF7 | DMA_HIFCR_CHTIF7 | DMA_HIFCR_CTEIF7 | \
+                                          DMA_HIFCR_CDMEIF7 | DMA_HIFCR_CFEIF7)
+
+static char buffer[UART_LOG_BUFFER_SIZE];
+static volatile uint32_t head = 0; //counters only grow, character n lives in buffer[n % UART_LOG_BUFFER_SIZE]
+static volatile uint32_t tail = 0;
+static volatile uint32_t sending = 0; //length of running DMA transfer, 0 when idle
+
+static UART_HandleTypeDef *uart = NULL;
+static SemaphoreHandle_t space_sem;
+#ifdef UART_LOG_BLOCKING
+static uart_log_policy_t policy = UART_LOG_BLOCK;
+#else
+static uart_log_policy_t policy = UART_LOG_DROP;
+#endif
+static volatile uart_log_stats_t stats;
+
+void uart_log_init(UART_HandleTypeDef *huart){
+	space_sem = xSemaphoreCreateBinary();
+
+	__HAL_RCC_DMA2_CLK_ENABLE();
+
+	UART_LOG_DMA->CR = 0;
+	while(UART_LOG_DMA->CR & DMA_SxCR_EN){
+	}
+	UART_LOG_DMA->PAR = (uint32_t)&huart->Instance->TDR;
+	UART_LOG_DMA->FCR = 0; //direct mode
+	DMA2->HIFCR = UART_LOG_DMA_FLAGS;
+
+	HAL_NVIC_SetPriority(UART_LOG_DMA_IRQ, 5, 0);
+	HAL_NVIC_EnableIRQ(UART_LOG_DMA_IRQ);
+
+	huart->Instance->CR3 |= USART_CR3_DMAT;
+	uart = huart;
+}
+
+void uart_log_set_policy(uart_log_policy_t new_policy){
+	policy = new_policy;
+}
+
+uart_log_policy_t uart_log_get_policy(void){
+	return policy;
+}
+
+//starts transfer of characters up to the end of buffer, the rest goes in next one
+static void uart_log_start(void){
+	uint32_t start = tail % UART_LOG_BUFFER_SIZE;
+	uint32_t len = head - tail;
+
+	if(len > UART_LOG_BUFFER_SIZE - start){
+		len = UART_LOG_BUFFER_SIZE - start;
+	}
+
+	sending = len;
+	stats.transfers++;
+
+	UART_LOG_DMA->M0AR = (uint32_t)&buffer[start];
+	UART_LOG_DMA->NDTR = len;
+	UART_LOG_DMA->CR = UART_LOG_DMA_CHANNEL | DMA_MEMORY_TO_PERIPH | DMA_MINC_ENABLE | DMA_PRIORITY_LOW |
+		DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_EN;
+}
+
+static bool uart_log_in_isr(void){
+	return __get_IPSR() != 0;
+}
+
+void uart_log_putc(char c){
+	if(uart == NULL){
+		debug_chr(c);
+		return;
+	}
+
+	bool isr = uart_log_in_isr();
+	bool can_wait = !isr && policy == UART_LOG_BLOCK && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+	bool waited = false;
+	UBaseType_t saved = 0;
+
+	for(;;){
+		if(isr){
+			saved = taskENTER_CRITICAL_FROM_ISR();
+		}else{
+			taskENTER_CRITICAL();
+		}
+
+		if(head - tail < UART_LOG_BUFFER_SIZE){
+			break;
+		}
+
+		if(isr){
+			taskEXIT_CRITICAL_FROM_ISR(saved);
+		}else{
+			taskEXIT_CRITICAL();
+		}
+
+		if(!can_wait){
+			stats.dropped++;
+			return;
+		}
+
+		if(!waited){
+			stats.waits++;
+			waited = true;
+		}
+		xSemaphoreTake(space_sem, 1); //other writers may wait for the same transfer
+	}
+
+	buffer[head % UART_LOG_BUFFER_SIZE] = c;
+	head++;
+	stats.written++;
+	if(head - tail > stats.max_used){
+		stats.max_used = head - tail;
+	}
+	if(!sending){
+		uart_log_start();
+	}
+
+	if(isr){
+		taskEXIT_CRITICAL_FROM_ISR(saved);
+	}else{
+		taskEXIT_CRITICAL();
+	}
+}
+
+void uart_log_flush(void){
+	while(uart != NULL && head != tail){
+		xSemaphoreTake(space_sem, 1);
+	}
+}
+
+bool uart_log_dma_irq_handler(void){
+	BaseType_t woken = pdFALSE;
+
+	if(uart == NULL || !(DMA2->HISR & (DMA_HISR_TCIF7 | DMA_HISR_TEIF7))){
+		return false;
+	}
+
+	DMA2->HIFCR = UART_LOG_DMA_FLAGS;
+
+	tail += sending;
+	sending = 0;
+	if(head != tail){
+		uart_log_start();
+	}
+
+	xSemaphoreGiveFromISR(space_sem, &woken);
+	portYIELD_FROM_ISR(woken);
+
+	return true;
+}
+
+const uart_log_stats_t *uart_log_get_stats(void){
+	return (const uart_log_stats_t *)&stats;
+}
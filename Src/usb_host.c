@@ -54,6 +54,7 @@
 #include "usbh_hid.h"
 
 /* USER CODE BEGIN Includes */
+#include "usb_keyboard.h"
 
 /* USER CODE END Includes */
 
@@ -125,6 +126,7 @@ static void USBH_UserProcess  (USBH_HandleTypeDef *phost, uint8_t id)
 
   case HOST_USER_DISCONNECTION:
   Appli_state = APPLICATION_DISCONNECT;
+  usb_keyboard_disconnected();
   break;
 
   case HOST_USER_CLASS_ACTIVE:
@@ -0,0 +1,93 @@
+#include <usb_keyboard.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "usbh_hid.h"
+#include "input_queue.h"
+#include "dwt.h"
+
+#define USB_KEYBOARD_KEYS                6 //keys in boot protocol report
+#define USB_KEYBOARD_ERROR_ROLLOVER      0x01
+
+static uint8_t pressed[USB_KEYBOARD_KEYS]; //usage codes of keys held in previous report
+static usb_keyboard_stats_t stats;
+
+//maps HID usage code to game key, 0 for keys not used by the game
+static uint8_t usb_keyboard_key(uint8_t usage){
+	if(usage >= KEY_A && usage <= KEY_Z){
+		return 'a' + (usage - KEY_A);
+	}
+
+	switch(usage){
+	case KEY_SPACEBAR:
+		return ' ';
+	case KEY_UPARROW: //by direction on the LCD, wsad follow the camera rotation of moveCursor()
+		return 's';
+	case KEY_DOWNARROW:
+		return 'w';
+	case KEY_LEFTARROW:
+		return 'd';
+	case KEY_RIGHTARROW:
+		return 'a';
+	default:
+		return 0;
+	}
+}
+
+static bool usb_keyboard_contains(const uint8_t *keys, uint8_t usage){
+	for(uint32_t i = 0; i < USB_KEYBOARD_KEYS; i++){
+		if(keys[i] == usage){
+			return true;
+		}
+	}
+	return false;
+}
+
+//posts events for keys in a which are missing in b
+static void usb_keyboard_diff(const uint8_t *a, const uint8_t *b, input_event_type_t type, uint32_t cycles){
+	for(uint32_t i = 0; i < USB_KEYBOARD_KEYS; i++){
+		uint8_t key = usb_keyboard_key(a[i]);
+		if(key && !usb_keyboard_contains(b, a[i])){
+			input_queue_post(INPUT_SOURCE_USB, type, key, 0, cycles);
+			if(type == INPUT_KEY_DOWN){
+				stats.downs++;
+			}else{
+				stats.ups++;
+			}
+		}
+	}
+}
+
+void usb_keyboard_report(USBH_HandleTypeDef *phost){
+	uint32_t cycles = dwt_cycles();
+
+	if(USBH_HID_GetDeviceType(phost) != HID_KEYBOARD){
+		return;
+	}
+
+	HID_KEYBD_Info_TypeDef *info = USBH_HID_GetKeybdInfo(phost);
+	if(info == NULL){
+		return;
+	}
+
+	stats.reports++;
+	if(info->keys[0] == USB_KEYBOARD_ERROR_ROLLOVER){ //key state unknown, keep previous one
+		stats.rollovers++;
+		return;
+	}
+
+	usb_keyboard_diff(pressed, info->keys, INPUT_KEY_UP, cycles);
+	usb_keyboard_diff(info->keys, pressed, INPUT_KEY_DOWN, cycles);
+	memcpy(pressed, info->keys, sizeof(pressed));
+}
+
+void usb_keyboard_disconnected(void){
+	static const uint8_t none[USB_KEYBOARD_KEYS];
+
+	usb_keyboard_diff(pressed, none, INPUT_KEY_UP, dwt_cycles());
+	memset(pressed, 0, sizeof(pressed));
+}
+
+const usb_keyboard_stats_t *usb_keyboard_get_stats(void){
+	return &stats;
+}
@@ -0,0 +1,161 @@
+// Host-side benchmark of the board engine, compares moves/sec of the old
+// char-string board with the bitboard representation from sokoban_board.c
+//
+// build and run from repository root:
+//   gcc -O2 -IInc tools/board_bench.c Src/sokoban_board.c -o board_bench && ./board_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sokoban_board.h"
+
+#define BENCH_MOVES                      20000000
+
+static const char *bench_level =
+	"                                                                       ***                           *x*                           * ****                    *****o ox*                    *x   op***                    ******o*                           * *                           *x*                           ***                                                                                                                                                                                                   ";
+
+static const int32_t bench_deltas[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+//char-string engine as it was in sokoban.c before the bitboard rewrite, kept as it was including
+//its bug: a stone can be pushed onto a stone on target, nothing is updated and the player walks
+//into the stone cell
+typedef struct{
+	char data[BOARD_CELLS + 1];
+	sokoban_point_t player;
+} legacy_board_t;
+
+static char *legacy_cell(legacy_board_t *b, sokoban_point_t pt){
+	return &b->data[pt.x * BOARD_WIDTH + pt.y];
+}
+
+static void legacy_update(legacy_board_t *b, sokoban_point_t old, sokoban_point_t new){
+	char *old_data = legacy_cell(b, old);
+	char *new_data = legacy_cell(b, new);
+
+	if(*old_data == SOKOBAN_MAP_PLAYER){
+		if(*new_data == SOKOBAN_MAP_EMPTY){
+			*old_data = SOKOBAN_MAP_EMPTY;
+			*new_data = SOKOBAN_MAP_PLAYER;
+		}else if(*new_data == SOKOBAN_MAP_TARGET){
+			*old_data = SOKOBAN_MAP_EMPTY;
+			*new_data = SOKOBAN_MAP_PLAYER_ON_TARGET;
+		}
+	}else if(*old_data == SOKOBAN_MAP_PLAYER_ON_TARGET){
+		if(*new_data == SOKOBAN_MAP_EMPTY){
+			*old_data = SOKOBAN_MAP_TARGET;
+			*new_data = SOKOBAN_MAP_PLAYER;
+		}else if(*new_data == SOKOBAN_MAP_TARGET){
+			*old_data = SOKOBAN_MAP_TARGET;
+			*new_data = SOKOBAN_MAP_PLAYER_ON_TARGET;
+		}
+	}else if(*old_data == SOKOBAN_MAP_STONE){
+		if(*new_data == SOKOBAN_MAP_EMPTY){
+			*old_data = SOKOBAN_MAP_EMPTY;
+			*new_data = SOKOBAN_MAP_STONE;
+		}else if(*new_data == SOKOBAN_MAP_TARGET){
+			*old_data = SOKOBAN_MAP_EMPTY;
+			*new_data = SOKOBAN_MAP_STONE_ON_TARGET;
+		}
+	}else if(*old_data == SOKOBAN_MAP_STONE_ON_TARGET){
+		if(*new_data == SOKOBAN_MAP_EMPTY){
+			*old_data = SOKOBAN_MAP_TARGET;
+			*new_data = SOKOBAN_MAP_STONE;
+		}else if(*new_data == SOKOBAN_MAP_TARGET){
+			*old_data = SOKOBAN_MAP_TARGET;
+			*new_data = SOKOBAN_MAP_STONE_ON_TARGET;
+		}
+	}
+}
+
+static uint32_t legacy_count(const char *s, char c){
+	uint32_t cnt = 0;
+	for(int i = 0; s[i]; i++){
+		cnt += (s[i] == c);
+	}
+
+	return cnt;
+}
+
+static bool legacy_move(legacy_board_t *b, int32_t dx, int32_t dy, uint32_t target_num){
+	sokoban_point_t np = {b->player.x + dx, b->player.y + dy};
+	if(np.x >= BOARD_HEIGHT || np.y >= BOARD_WIDTH || *legacy_cell(b, np) == SOKOBAN_MAP_WALL){
+		return false;
+	}
+
+	char c = *legacy_cell(b, np);
+	if(c == SOKOBAN_MAP_STONE || c == SOKOBAN_MAP_STONE_ON_TARGET){
+		sokoban_point_t sp = {np.x + dx, np.y + dy};
+		char sc = *legacy_cell(b, sp);
+		if(sc == SOKOBAN_MAP_WALL || sc == SOKOBAN_MAP_STONE){
+			return false;
+		}
+		legacy_update(b, np, sp);
+	}
+
+	legacy_update(b, b->player, np);
+	b->player = np;
+
+	return legacy_count(b->data, SOKOBAN_MAP_STONE_ON_TARGET) == target_num; //win check after every move
+}
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void){
+	uint32_t seed, solved;
+	double t;
+
+	legacy_board_t legacy;
+	strcpy(legacy.data, bench_level);
+	uint32_t pl = strchr(legacy.data, SOKOBAN_MAP_PLAYER) - legacy.data;
+	legacy.player.x = pl / BOARD_WIDTH;
+	legacy.player.y = pl % BOARD_WIDTH;
+	uint32_t legacy_targets = legacy_count(legacy.data, SOKOBAN_MAP_TARGET);
+
+	seed = 1; solved = 0;
+	t = now();
+	for(uint32_t i = 0; i < BENCH_MOVES; i++){
+		seed = seed * 1103515245 + 12345;
+		const int32_t *d = bench_deltas[(seed >> 16) & 3];
+		solved += legacy_move(&legacy, d[0], d[1], legacy_targets);
+	}
+	t = now() - t;
+	printf("char board: %10.0f moves/s (%u solved states)\n", BENCH_MOVES / t, solved);
+
+	sokoban_board_init_zobrist(1);
+	sokoban_board_t board;
+	sokoban_board_load(&board, bench_level);
+
+	seed = 1; solved = 0;
+	t = now();
+	for(uint32_t i = 0; i < BENCH_MOVES; i++){
+		seed = seed * 1103515245 + 12345;
+		const int32_t *d = bench_deltas[(seed >> 16) & 3];
+		if(sokoban_board_move(&board, d[0], d[1]) != SOKOBAN_MOVE_BLOCKED){
+			solved += sokoban_board_solved(&board);
+		}
+	}
+	t = now() - t;
+	printf("bitboard:   %10.0f moves/s (%u solved states)\n", BENCH_MOVES / t, solved);
+
+	//validate incremental stones on target counter and hash against full scan
+	uint32_t mismatches = 0, hash_mismatches = 0;
+	sokoban_board_load(&board, bench_level);
+	seed = 1;
+	for(uint32_t i = 0; i < BENCH_MOVES / 100; i++){
+		seed = seed * 1103515245 + 12345;
+		const int32_t *d = bench_deltas[(seed >> 16) & 3];
+		sokoban_board_move(&board, d[0], d[1]);
+		mismatches += (board.stones_on_target != sokoban_board_scan_on_target(&board));
+		hash_mismatches += (board.hash != sokoban_board_scan_hash(&board));
+	}
+	printf("stones on target counter mismatches: %u\n", mismatches);
+	printf("hash mismatches: %u\n", hash_mismatches);
+
+	return mismatches != 0 || hash_mismatches != 0;
+}
@@ -0,0 +1,92 @@
+// Host-side check of the bit-packed undo log from sokoban_history.c against a plain array,
+// logs more steps than the ring holds, so undo and redo run across its wrap and the
+// overwritten oldest steps, and redo is cut by new steps in between
+//
+// build and run from repository root:
+//   gcc -O2 -IInc tools/history_check.c Src/sokoban_history.c -o history_check && ./history_check
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sokoban_history.h"
+
+#define CHECK_STEPS                      (SOKOBAN_HISTORY_STEPS * 5 / 2)
+#define CHECK_OPS                        20000
+#define CHECK_BURST                      64
+
+//reference log, steps[base..end) are kept, pos is the next step to redo
+static uint8_t steps[CHECK_STEPS + CHECK_OPS * CHECK_BURST];
+static uint32_t base, pos, end;
+static uint32_t failures;
+
+static void ref_push(uint8_t step){
+	steps[pos++] = step;
+	end = pos;
+	if(pos - base > SOKOBAN_HISTORY_STEPS){
+		base++;
+	}
+}
+
+static void push(sokoban_history_t *history, uint8_t step){
+	sokoban_history_push(history, step);
+	ref_push(step);
+}
+
+static void check(const char *what, bool ok, uint8_t step, bool ref_ok, uint8_t ref_step){
+	if(ok != ref_ok || (ok && step != ref_step)){
+		if(failures++ < 10){
+			printf("%s mismatch at step %u: got %d/%u, expected %d/%u\n", what, pos, ok, step, ref_ok, ref_step);
+		}
+	}
+}
+
+static void undo(sokoban_history_t *history){
+	uint8_t step = 0;
+	bool ok = sokoban_history_undo(history, &step);
+	bool ref_ok = pos > base;
+	uint8_t ref_step = ref_ok ? steps[--pos] : 0;
+	check("undo", ok, step, ref_ok, ref_step);
+}
+
+static void redo(sokoban_history_t *history){
+	uint8_t step = 0;
+	bool ok = sokoban_history_redo(history, &step);
+	bool ref_ok = pos < end;
+	uint8_t ref_step = ref_ok ? steps[pos++] : 0;
+	check("redo", ok, step, ref_ok, ref_step);
+}
+
+int main(void){
+	static sokoban_history_t history;
+	srand(1);
+	sokoban_history_clear(&history);
+
+	//fill past the wrap, then undo everything that is kept and redo it all again
+	for(uint32_t i = 0; i < CHECK_STEPS; i++){
+		push(&history, rand() & 7);
+	}
+	for(uint32_t i = 0; i <= SOKOBAN_HISTORY_STEPS; i++){
+		undo(&history); //the last one has to fail, oldest steps are gone
+	}
+	for(uint32_t i = 0; i <= SOKOBAN_HISTORY_STEPS; i++){
+		redo(&history);
+	}
+
+	//random walk of bursts, redo is truncated by every push in between
+	for(uint32_t i = 0; i < CHECK_OPS; i++){
+		uint32_t op = rand() % 8;
+		uint32_t len = 1 + rand() % CHECK_BURST;
+		for(uint32_t j = 0; j < len; j++){
+			if(op < 4){
+				push(&history, rand() & 7);
+			}else if(op < 6){
+				undo(&history);
+			}else{
+				redo(&history);
+			}
+		}
+	}
+
+	printf("%u steps logged in %u bytes, %u failures\n", end, (unsigned)sizeof(history.data), failures);
+	return failures != 0;
+}
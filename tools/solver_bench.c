@@ -0,0 +1,221 @@
+// Host-side benchmark of the push solver from sokoban_solver.c, solves a few levels
+// with about the table size used on the target and checks every solution by replaying it
+//
+// build and run from repository root:
+//   gcc -O2 -IInc tools/solver_bench.c Src/sokoban_solver.c Src/sokoban_board.c -o solver_bench && ./solver_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sokoban_solver.h"
+
+#define BENCH_MAX_PUSHES                 1024
+#define BENCH_MEMORY                     (6 * 1024 * 1024) //about the SDRAM left after framebuffers on the target
+
+//levels in XSB notation, first three are the built-in ones, then a few from Microban
+//and the first two classic levels
+static const char *bench_levels[][BOARD_HEIGHT] = {
+	{
+		"    ###",
+		"    #.#",
+		"    # ####",
+		"#####$ $.#",
+		"#.   $@###",
+		"######$#",
+		"     # #",
+		"     #.#",
+		"     ###",
+	},
+	{
+		"#######",
+		"# #   #",
+		"# @$$ #",
+		"# $   #",
+		"# ... #",
+		"#######",
+	},
+	{
+		"####",
+		"# .#",
+		"#  ###",
+		"#*@  #",
+		"#  $ #",
+		"#  ###",
+		"####",
+	},
+	{
+		"######",
+		"#    #",
+		"# #@ #",
+		"# $* #",
+		"# .* #",
+		"#    #",
+		"######",
+	},
+	{
+		"  ####",
+		"###  ####",
+		"#     $ #",
+		"# #  #$ #",
+		"# . .#@ #",
+		"#########",
+	},
+	{
+		"########",
+		"#      #",
+		"# .**$@#",
+		"#      #",
+		"#####  #",
+		"    ####",
+	},
+	{
+		" #######",
+		" #     #",
+		" # .$. #",
+		"## $@$ #",
+		"#  .$. #",
+		"#      #",
+		"########",
+	},
+	{
+		"    #####",
+		"    #   #",
+		"    #$  #",
+		"  ###  $##",
+		"  #  $ $ #",
+		"### # ## #   ######",
+		"#   # ## #####  ..#",
+		"# $  $          ..#",
+		"##### ### #@##  ..#",
+		"    #     #########",
+		"    #######",
+	},
+	{
+		"############",
+		"#..  #     ###",
+		"#..  # $  $  #",
+		"#..  #$####  #",
+		"#..    @ ##  #",
+		"#..  # #  $ ##",
+		"###### ##$ $ #",
+		"  # $  $ $ $ #",
+		"  #    #     #",
+		"  ############",
+	},
+};
+
+static void xsb_to_level(const char **rows, char *level){
+	memset(level, SOKOBAN_MAP_EMPTY, BOARD_CELLS);
+	level[BOARD_CELLS] = 0;
+
+	for(uint32_t row = 0; row < BOARD_HEIGHT && rows[row] != NULL; row++){
+		for(uint32_t col = 0; rows[row][col]; col++){
+			static const char from[] = "#@+$*.";
+			static const char to[] = {SOKOBAN_MAP_WALL, SOKOBAN_MAP_PLAYER, SOKOBAN_MAP_PLAYER_ON_TARGET,
+				SOKOBAN_MAP_STONE, SOKOBAN_MAP_STONE_ON_TARGET, SOKOBAN_MAP_TARGET};
+			const char *c = strchr(from, rows[row][col]);
+			if(c != NULL && *c){
+				level[row * BOARD_WIDTH + col] = to[c - from];
+			}
+		}
+	}
+}
+
+//true when the player can walk to cell without pushing
+static bool walkable_to(const sokoban_board_t *board, uint32_t goal){
+	static uint16_t queue[BOARD_CELLS];
+	bool seen[BOARD_CELLS] = {false};
+	uint32_t head = 0, tail = 0;
+
+	uint32_t start = board->player_pos.x * BOARD_WIDTH + board->player_pos.y;
+	seen[start] = true;
+	queue[tail++] = start;
+
+	while(head < tail){
+		uint32_t idx = queue[head++];
+		if(idx == goal){
+			return true;
+		}
+		for(int dir = 0; dir < 4; dir++){
+			sokoban_point_t pt = {idx / BOARD_WIDTH + sokoban_dir_delta[dir][0], idx % BOARD_WIDTH + sokoban_dir_delta[dir][1]};
+			uint32_t next = pt.x * BOARD_WIDTH + pt.y;
+			if(pt.x < BOARD_HEIGHT && pt.y < BOARD_WIDTH && !seen[next] &&
+				!sokoban_bitset_test(board->wall, pt) && !sokoban_bitset_test(board->stone, pt)){
+				seen[next] = true;
+				queue[tail++] = next;
+			}
+		}
+	}
+	return false;
+}
+
+static bool replay(sokoban_board_t *board, const uint16_t *pushes, uint32_t push_num){
+	for(uint32_t i = 0; i < push_num; i++){
+		uint32_t cell = SOKOBAN_PUSH_CELL(pushes[i]);
+		sokoban_dir_t dir = SOKOBAN_PUSH_DIR(pushes[i]);
+		sokoban_point_t stand = {cell / BOARD_WIDTH - sokoban_dir_delta[dir][0], cell % BOARD_WIDTH - sokoban_dir_delta[dir][1]};
+
+		if(!walkable_to(board, stand.x * BOARD_WIDTH + stand.y)){
+			return false;
+		}
+
+		sokoban_bitset_clear(board->player, board->player_pos);
+		sokoban_bitset_set(board->player, stand);
+		board->player_pos = stand;
+		if(sokoban_board_move(board, sokoban_dir_delta[dir][0], sokoban_dir_delta[dir][1]) != SOKOBAN_MOVE_PUSH){
+			return false;
+		}
+	}
+
+	return sokoban_board_solved(board);
+}
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv){
+	static const char *results[] = {"solved", "unsolvable", "out of memory", "cancelled"};
+	static sokoban_solver_t solver;
+	static uint16_t pushes[BENCH_MAX_PUSHES];
+	uint32_t memory_size = BENCH_MEMORY;
+	uint32_t failures = 0;
+
+	if(argc > 1){ //table size in KB, to see how the search copes when it fills up
+		memory_size = atoi(argv[1]) * 1024;
+	}
+	void *memory = malloc(memory_size);
+
+	sokoban_board_init_zobrist(1);
+	sokoban_solver_init(&solver, memory, memory_size);
+	printf("table: %u bytes\n", memory_size);
+
+	for(uint32_t i = 0; i < sizeof(bench_levels) / sizeof(bench_levels[0]); i++){
+		char level[BOARD_CELLS + 1];
+		sokoban_board_t board;
+		xsb_to_level(bench_levels[i], level);
+		sokoban_board_load(&board, level);
+
+		uint32_t push_num;
+		double t = now();
+		sokoban_solver_result_t result = sokoban_solver_solve(&solver, &board, pushes, BENCH_MAX_PUSHES, &push_num, NULL);
+		t = now() - t;
+
+		const sokoban_solver_stats_t *s = &solver.stats;
+		bool ok = result != SOKOBAN_SOLVER_SOLVED || replay(&board, pushes, push_num);
+		failures += !ok;
+
+		printf("level %u: %s, %u pushes%s, %u expanded, %u stored (%.1f%%), %u deadlocks, %.0f nodes/s\n", i, results[result],
+			push_num, ok ? "" : " (replay FAILED)", s->expanded, s->nodes, 100.0 * s->nodes / s->capacity, s->deadlocks, s->expanded / t);
+		printf("  heuristic: %u matchings, %u repairs, %u distance tables\n", s->matchings, s->repairs, s->tables);
+		printf("  table: %u nodes of %u bytes in %u bytes, %u forgotten in %u evictions\n", s->capacity, s->node_bytes,
+			s->memory, s->evicted, s->evictions);
+	}
+
+	free(memory);
+	return failures != 0;
+}
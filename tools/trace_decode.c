@@ -0,0 +1,271 @@
+// Host-side decoder of the binary trace buffer from trace.c, format strings and %s
+// arguments are read from the firmware ELF
+//
+// build from repository root:
+//   gcc -O2 tools/trace_decode.c -o trace_decode
+//
+// the buffer is taken either from terminal output of 'x' (lines starting with "trace")
+// or from binary dump written by gdb:
+//   dump binary value trace.bin trace_buffer
+//
+// usage:
+//   ./trace_decode build/project.elf terminal.log
+//   ./trace_decode build/project.elf trace.bin
+
+#include <elf.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC                      0x32435254 //"TRC2", as in trace.h
+#define TRACE_RECORD_SIZE                24
+#define TRACE_MAX_ARGS                   3
+
+typedef struct{
+	uint32_t index;
+	uint32_t cycles;
+	uint32_t tick;
+	uint32_t fmt;
+	uint32_t args[TRACE_MAX_ARGS];
+} decoded_record_t;
+
+//allocated sections of the ELF with contents, used to resolve target addresses
+typedef struct{
+	uint32_t addr;
+	uint32_t size;
+	const uint8_t *data;
+} elf_section_t;
+
+static uint8_t *elf_image;
+static elf_section_t *sections;
+static uint32_t section_num;
+
+static decoded_record_t *records;
+static uint32_t record_num;
+static uint32_t core_clock = 200000000;
+
+static uint8_t *read_file(const char *path, size_t *size){
+	FILE *f = fopen(path, "rb");
+	if(f == NULL){
+		perror(path);
+		exit(1);
+	}
+
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	uint8_t *data = malloc(*size + 1);
+	if(fread(data, 1, *size, f) != *size){
+		perror(path);
+		exit(1);
+	}
+	data[*size] = 0;
+	fclose(f);
+
+	return data;
+}
+
+static void load_elf(const char *path){
+	size_t size;
+	elf_image = read_file(path, &size);
+
+	const Elf32_Ehdr *header = (const Elf32_Ehdr *)elf_image;
+	if(size < sizeof(Elf32_Ehdr) || memcmp(header->e_ident, ELFMAG, SELFMAG) || header->e_ident[EI_CLASS] != ELFCLASS32){
+		fprintf(stderr, "%s: not a 32-bit ELF file\n", path);
+		exit(1);
+	}
+
+	const Elf32_Shdr *shdr = (const Elf32_Shdr *)(elf_image + header->e_shoff);
+	sections = calloc(header->e_shnum, sizeof(elf_section_t));
+
+	for(uint32_t i = 0; i < header->e_shnum; i++){
+		if(shdr[i].sh_type == SHT_PROGBITS && (shdr[i].sh_flags & SHF_ALLOC) && shdr[i].sh_offset + shdr[i].sh_size <= size){
+			sections[section_num++] = (elf_section_t){shdr[i].sh_addr, shdr[i].sh_size, elf_image + shdr[i].sh_offset};
+		}
+	}
+}
+
+//returns NUL terminated string at target address or NULL when it isn't in the ELF
+static const char *elf_string(uint32_t addr){
+	for(uint32_t i = 0; i < section_num; i++){
+		const elf_section_t *s = &sections[i];
+		if(addr >= s->addr && addr < s->addr + s->size){
+			const char *str = (const char *)s->data + (addr - s->addr);
+			if(memchr(str, 0, s->addr + s->size - addr) != NULL){
+				return str;
+			}
+		}
+	}
+	return NULL;
+}
+
+static void add_record(const decoded_record_t *record){
+	static uint32_t capacity = 0;
+
+	if(record_num == capacity){
+		capacity = capacity ? capacity * 2 : 1024;
+		records = realloc(records, capacity * sizeof(decoded_record_t));
+	}
+	records[record_num++] = *record;
+}
+
+static void load_binary_dump(const uint8_t *data, size_t size){
+	uint32_t header[4];
+	memcpy(header, data, sizeof(header));
+
+	uint32_t len = header[1];
+	uint32_t head = header[2];
+	core_clock = header[3];
+
+	if(size < sizeof(header) + (size_t)len * TRACE_RECORD_SIZE){
+		fprintf(stderr, "dump is shorter than %u records\n", len);
+		exit(1);
+	}
+
+	for(uint32_t i = head > len ? head - len : 0; i < head; i++){
+		const uint8_t *r = data + sizeof(header) + (i % len) * TRACE_RECORD_SIZE;
+		decoded_record_t record = {.index = i};
+		memcpy(&record.cycles, r, 4);
+		memcpy(&record.tick, r + 4, 4);
+		memcpy(&record.fmt, r + 8, 4);
+		memcpy(record.args, r + 12, sizeof(record.args));
+		add_record(&record);
+	}
+}
+
+static void load_text_dump(char *text){
+	for(char *line = strtok(text, "\r\n"); line != NULL; line = strtok(NULL, "\r\n")){
+		char *start = strstr(line, "trace ");
+		if(start == NULL){
+			continue;
+		}
+
+		unsigned int w[7];
+		if(sscanf(start, "trace header %x %x %x %x", &w[0], &w[1], &w[2], &w[3]) == 4){
+			core_clock = w[3];
+			record_num = 0; //only the last dump in the log is decoded
+		}else if(sscanf(start, "trace %x %x %x %x %x %x %x", &w[0], &w[1], &w[2], &w[3], &w[4], &w[5], &w[6]) == 7){
+			decoded_record_t record = {w[0], w[1], w[2], w[3], {w[4], w[5], w[6]}};
+			add_record(&record);
+		}
+	}
+}
+
+//prints record with its format, arguments are 32-bit so length modifiers are dropped
+static void print_message(const decoded_record_t *record){
+	const char *fmt = elf_string(record->fmt);
+	uint32_t arg = 0;
+
+	if(fmt == NULL){
+		printf("<unknown format 0x%08X> %08X %08X %08X", record->fmt, record->args[0], record->args[1], record->args[2]);
+		return;
+	}
+
+	while(*fmt){
+		if(*fmt != '%'){
+			putchar(*fmt++);
+			continue;
+		}
+
+		char spec[32] = "%";
+		size_t len = 1;
+		fmt++;
+		while(*fmt && strchr("-+ #0123456789.", *fmt) && len < sizeof(spec) - 3){
+			spec[len++] = *fmt++;
+		}
+		while(*fmt == 'l' || *fmt == 'h' || *fmt == 'z'){
+			fmt++;
+		}
+
+		char conv = *fmt;
+		if(conv == 0){
+			break;
+		}
+		fmt++;
+
+		if(conv == '%'){
+			putchar('%');
+			continue;
+		}
+
+		uint32_t value = arg < TRACE_MAX_ARGS ? record->args[arg] : 0;
+		arg++;
+		spec[len++] = conv;
+		spec[len] = 0;
+
+		switch(conv){
+		case 'd':
+		case 'i':
+			printf(spec, (int)(int32_t)value);
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+		case 'c':
+			printf(spec, (unsigned int)value);
+			break;
+		case 's':{
+			const char *str = elf_string(value);
+			if(str != NULL){
+				printf(spec, str);
+			}else{
+				printf("<0x%08X>", value);
+			}
+			break;
+		}
+		default:
+			printf("0x%08X", value);
+			break;
+		}
+	}
+}
+
+int main(int argc, char **argv){
+	if(argc != 3){
+		fprintf(stderr, "usage: %s firmware.elf trace.bin|terminal.log\n", argv[0]);
+		return 1;
+	}
+
+	load_elf(argv[1]);
+
+	size_t size;
+	uint8_t *dump = read_file(argv[2], &size);
+	uint32_t magic = 0;
+	if(size >= 4){
+		memcpy(&magic, dump, 4);
+	}
+
+	if(magic == TRACE_MAGIC){
+		load_binary_dump(dump, size);
+	}else{
+		load_text_dump((char *)dump);
+	}
+
+	if(record_num == 0){
+		fprintf(stderr, "no trace records found\n");
+		return 1;
+	}
+
+	//cycle counter wraps every ~20 s, the millisecond tick tells how many times it did
+	//between two records, cycles then give the exact remainder
+	double us_per_cycle = 1e6 / core_clock;
+	uint64_t elapsed = 0;
+
+	for(uint32_t i = 0; i < record_num; i++){
+		if(i > 0){
+			uint32_t delta = records[i].cycles - records[i - 1].cycles;
+			double tick_cycles = (double)(uint32_t)(records[i].tick - records[i - 1].tick) * (core_clock / 1000);
+			double wraps = (tick_cycles - delta) / 4294967296.0;
+			elapsed += delta + (wraps > 0.5 ? (uint64_t)(wraps + 0.5) << 32 : 0);
+		}
+		printf("%8u %12.3f us  ", records[i].index, elapsed * us_per_cycle);
+		print_message(&records[i]);
+		putchar('\n');
+	}
+
+	return 0;
+}